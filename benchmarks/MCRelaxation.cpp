@@ -0,0 +1,128 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCCodeEmitter.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCParser/MCAsmParser.h"
+#include "llvm/MC/MCParser/MCTargetAsmParser.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/MCTargetOptions.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static const char *TripleName = "x86_64-unknown-linux-gnu";
+
+// Builds an assembly file with NumFunctions functions of NumBlocks blocks each.
+// Every block ends with a conditional branch a few blocks ahead, and the blocks
+// vary in size, so that many branches need the long encoding and relaxing one
+// pushes others out of range. Line tables and CFI add fragments in other
+// sections that depend on the layout of the code.
+//
+// If CascadeLength isn't zero, the file starts with a function of that many
+// branches, each jumping just over the next one. Only the last one is out of
+// range at first, and relaxing a branch pushes the one before it out of range,
+// so every branch is relaxed in a step of its own.
+static std::string buildInput(unsigned NumFunctions, unsigned NumBlocks,
+                              unsigned CascadeLength) {
+  std::string Asm;
+  raw_string_ostream OS(Asm);
+  OS << "\t.text\n\t.file 1 \"input.c\"\n";
+  if (CascadeLength) {
+    OS << "\t.globl cascade\n\t.p2align 4\ncascade:\n";
+    for (unsigned B = 0; B != CascadeLength; ++B) {
+      OS << "\tjne .Lcascade" << B << "\n";
+      for (unsigned I = 0; I != 15; ++I)
+        OS << "\taddq $1, %rax\n";
+      for (unsigned I = 0, E = B + 1 == CascadeLength ? 10 : 2; I != E; ++I)
+        OS << "\tnop\n";
+      if (B)
+        OS << ".Lcascade" << B - 1 << ":\n";
+    }
+    OS << ".Lcascade" << CascadeLength - 1 << ":\n\tretq\n";
+  }
+  for (unsigned F = 0; F != NumFunctions; ++F) {
+    OS << "\t.globl f" << F << "\n\t.p2align 4\nf" << F << ":\n"
+       << "\t.cfi_startproc\n\tpushq %rbp\n\t.cfi_def_cfa_offset 16\n";
+    for (unsigned B = 0; B != NumBlocks; ++B) {
+      OS << ".Lf" << F << "_" << B << ":\n\t.loc 1 " << B + 1 << "\n";
+      for (unsigned I = 0, E = (B * 7 + F) % 11; I != E; ++I)
+        OS << "\taddq $" << I << ", %rax\n";
+      OS << "\tjne .Lf" << F << "_" << std::min(B + 1 + B % 5, NumBlocks)
+         << "\n";
+    }
+    OS << ".Lf" << F << "_" << NumBlocks << ":\n"
+       << "\tpopq %rbp\n\tretq\n\t.cfi_endproc\n";
+  }
+  return OS.str();
+}
+
+// Assembling the input into an object file, which is dominated by relaxation
+// when many branches are in range of a relaxation boundary.
+static void BM_AssembleBranches(benchmark::State &State) {
+  InitializeAllTargetInfos();
+  InitializeAllTargetMCs();
+  InitializeAllAsmParsers();
+  std::string Error;
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleName, Error);
+  if (!TheTarget) {
+    State.SkipWithError(Error.c_str());
+    return;
+  }
+
+  std::string Input =
+      buildInput(State.range(0), State.range(1), State.range(2));
+  MCTargetOptions MCOptions;
+  std::unique_ptr<MCRegisterInfo> MRI(TheTarget->createMCRegInfo(TripleName));
+  std::unique_ptr<MCAsmInfo> MAI(
+      TheTarget->createMCAsmInfo(*MRI, TripleName, MCOptions));
+  std::unique_ptr<MCInstrInfo> MCII(TheTarget->createMCInstrInfo());
+  std::unique_ptr<MCSubtargetInfo> STI(
+      TheTarget->createMCSubtargetInfo(TripleName, "", ""));
+
+  for (auto _ : State) {
+    SourceMgr SrcMgr;
+    SrcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Input), SMLoc());
+    MCObjectFileInfo MOFI;
+    MCContext Ctx(MAI.get(), MRI.get(), &MOFI, &SrcMgr, &MCOptions);
+    MOFI.InitMCObjectFileInfo(Triple(TripleName), /*PIC=*/false, Ctx);
+
+    SmallString<0> Object;
+    raw_svector_ostream OS(Object);
+    MCCodeEmitter *CE = TheTarget->createMCCodeEmitter(*MCII, *MRI, Ctx);
+    MCAsmBackend *MAB = TheTarget->createMCAsmBackend(*STI, *MRI, MCOptions);
+    std::unique_ptr<MCStreamer> Str(TheTarget->createMCObjectStreamer(
+        Triple(TripleName), Ctx, std::unique_ptr<MCAsmBackend>(MAB),
+        MAB->createObjectWriter(OS), std::unique_ptr<MCCodeEmitter>(CE), *STI,
+        /*RelaxAll=*/false, /*IncrementalLinkerCompatible=*/false,
+        /*DWARFMustBeAtTheEnd=*/false));
+
+    std::unique_ptr<MCAsmParser> Parser(
+        createMCAsmParser(SrcMgr, Ctx, *Str, *MAI));
+    std::unique_ptr<MCTargetAsmParser> TAP(
+        TheTarget->createMCAsmParser(*STI, *Parser, *MCII, MCOptions));
+    Parser->setTargetParser(*TAP);
+    if (Parser->Run(/*NoInitialTextSection=*/false)) {
+      State.SkipWithError("failed to assemble the input");
+      return;
+    }
+    State.counters["ObjectBytes"] = Object.size();
+  }
+}
+BENCHMARK(BM_AssembleBranches)
+    ->Args({64, 256, 0})
+    ->Args({4, 8192, 0})
+    ->Args({64, 256, 1000})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
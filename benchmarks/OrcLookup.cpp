@@ -0,0 +1,65 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+// A session with two JITDylibs of absolute symbols, which are Ready as soon
+// as they are defined. It is shared by all the threads of a benchmark.
+struct ReadySymbols {
+  static const unsigned NumSymbols = 1024;
+
+  ExecutionSession ES;
+  JITDylib &First;
+  JITDylib &Second;
+  std::vector<SymbolStringPtr> FirstNames, SecondNames;
+
+  ReadySymbols()
+      : First(ES.createBareJITDylib("first")),
+        Second(ES.createBareJITDylib("second")) {
+    define(First, "a", FirstNames);
+    define(Second, "b", SecondNames);
+  }
+
+  void define(JITDylib &JD, StringRef Prefix,
+              std::vector<SymbolStringPtr> &Names) {
+    SymbolMap Symbols;
+    for (unsigned I = 0; I != NumSymbols; ++I) {
+      Names.push_back(ES.intern((Prefix + Twine(I)).str()));
+      Symbols[Names.back()] =
+          JITEvaluatedSymbol(0x1000 + I, JITSymbolFlags::Exported);
+    }
+    cantFail(JD.define(absoluteSymbols(std::move(Symbols))));
+  }
+};
+
+static ReadySymbols &getReadySymbols() {
+  static ReadySymbols Symbols;
+  return Symbols;
+}
+
+// Concurrent blocking lookups of Ready symbols of the first JITDylib of the
+// search order, which are served without the session lock.
+static void BM_LookupReady(benchmark::State &State) {
+  ReadySymbols &S = getReadySymbols();
+  JITDylibSearchOrder Order = makeJITDylibSearchOrder({&S.First, &S.Second});
+  unsigned I = State.thread_index * 97;
+  for (auto _ : State)
+    benchmark::DoNotOptimize(cantFail(
+        S.ES.lookup(Order, S.FirstNames[I++ % ReadySymbols::NumSymbols])));
+}
+BENCHMARK(BM_LookupReady)->ThreadRange(1, 64)->UseRealTime();
+
+// Concurrent blocking lookups of Ready symbols that are only found in the
+// second JITDylib, which take the session lock like any other query.
+static void BM_LookupReadyInSecondJITDylib(benchmark::State &State) {
+  ReadySymbols &S = getReadySymbols();
+  JITDylibSearchOrder Order = makeJITDylibSearchOrder({&S.First, &S.Second});
+  unsigned I = State.thread_index * 97;
+  for (auto _ : State)
+    benchmark::DoNotOptimize(cantFail(
+        S.ES.lookup(Order, S.SecondNames[I++ % ReadySymbols::NumSymbols])));
+}
+BENCHMARK(BM_LookupReadyInSecondJITDylib)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+#include "benchmark/benchmark.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+
+// Builds a function whose argument is used by each of NumInsts instructions,
+// each of which uses the previous one.
+static Function *buildUseChain(Module &M, unsigned NumInsts) {
+  LLVMContext &Ctx = M.getContext();
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  Function *F = Function::Create(FunctionType::get(Int64Ty, {Int64Ty}, false),
+                                 GlobalValue::ExternalLinkage, "f", M);
+  IRBuilder<> B(BasicBlock::Create(Ctx, "entry", F));
+  Value *Arg = F->getArg(0);
+  Value *V = Arg;
+  for (unsigned I = 0; I != NumInsts; ++I)
+    V = B.CreateXor(V, Arg);
+  B.CreateRet(V);
+  return F;
+}
+
+// Creating and destroying the IR, and the memory taken by its uses, which
+// LLVM_ENABLE_COMPACT_USES reduces.
+static void BM_BuildUseChain(benchmark::State &State) {
+  unsigned NumInsts = State.range(0);
+  for (auto _ : State) {
+    LLVMContext Ctx;
+    Module M("M", Ctx);
+    buildUseChain(M, NumInsts);
+  }
+  State.counters["UseBytes"] = (2.0 * NumInsts + 1) * sizeof(Use);
+}
+BENCHMARK(BM_BuildUseChain)->Arg(1 << 10)->Arg(1 << 16);
+
+// Walking the use list of a value, and finding the users, which
+// LLVM_ENABLE_COMPACT_USES makes slower.
+static void BM_GetUsers(benchmark::State &State) {
+  LLVMContext Ctx;
+  Module M("M", Ctx);
+  Argument *Arg = buildUseChain(M, State.range(0))->getArg(0);
+  for (auto _ : State)
+    for (Use &U : Arg->uses())
+      benchmark::DoNotOptimize(U.getUser());
+}
+BENCHMARK(BM_GetUsers)->Arg(1 << 10)->Arg(1 << 16);
+
+BENCHMARK_MAIN();
@@ -1042,6 +1042,8 @@ get_compile_definitions()
 
 option(LLVM_FORCE_ENABLE_STATS "Enable statistics collection for builds that wouldn't normally enable it" OFF)
 
+option(LLVM_ENABLE_COMPACT_USES "Find the User of a Use by walking its operand array instead of storing it in each Use" OFF)
+
 check_symbol_exists(os_signpost_interval_begin "os/signpost.h" macos_signposts_available)
 if(macos_signposts_available)
   check_cxx_source_compiles(
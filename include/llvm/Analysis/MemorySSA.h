@@ -499,11 +499,13 @@ public:
   using const_block_iterator = BasicBlock *const *;
 
   block_iterator block_begin() {
-    return reinterpret_cast<block_iterator>(op_begin() + ReservedSpace);
+    return reinterpret_cast<block_iterator>(
+        getHungoffPhiBlocks(op_begin(), ReservedSpace));
   }
 
   const_block_iterator block_begin() const {
-    return reinterpret_cast<const_block_iterator>(op_begin() + ReservedSpace);
+    return reinterpret_cast<const_block_iterator>(
+        getHungoffPhiBlocks(op_begin(), ReservedSpace));
   }
 
   block_iterator block_end() { return block_begin() + getNumOperands(); }
@@ -83,6 +83,7 @@ typedef llvm::function_ref<Optional<std::string>(StringRef)>
     Expected<std::unique_ptr<Module>>
     getModuleImpl(LLVMContext &Context, bool MaterializeAll,
                   bool ShouldLazyLoadMetadata, bool IsImporting,
+                  bool LoadMetadataOnDemand,
                   DataLayoutCallbackTy DataLayoutCallback);
 
   public:
@@ -97,10 +98,15 @@ typedef llvm::function_ref<Optional<std::string>(StringRef)>
     /// Read the bitcode module and prepare for lazy deserialization of function
     /// bodies. If ShouldLazyLoadMetadata is true, lazily load metadata as well.
     /// If IsImporting is true, this module is being parsed for ThinLTO
-    /// importing into another module.
-    Expected<std::unique_ptr<Module>> getLazyModule(LLVMContext &Context,
-                                                    bool ShouldLazyLoadMetadata,
-                                                    bool IsImporting);
+    /// importing into another module. If LoadMetadataOnDemand is true, the
+    /// module-level metadata block is indexed rather than parsed when the
+    /// metadata is materialized: only the named metadata and what it
+    /// references is loaded up front, and other nodes are loaded when first
+    /// referenced by a materialized function or global. This is always the
+    /// case when IsImporting is true.
+    Expected<std::unique_ptr<Module>>
+    getLazyModule(LLVMContext &Context, bool ShouldLazyLoadMetadata,
+                  bool IsImporting, bool LoadMetadataOnDemand = false);
 
     /// Read the entire bitcode module and return it.
     Expected<std::unique_ptr<Module>> parseModule(
@@ -247,6 +247,22 @@ public:
     BlockScope.pop_back();
   }
 
+  /// EmitSubblockWithBody - Emit a complete block whose body, that is
+  /// everything following the block size word up to and including the aligned
+  /// END_BLOCK, was encoded by another BitstreamWriter, e.g. on another thread.
+  /// The body must have been encoded with the abbreviations this stream would
+  /// have in scope in the block.
+  void EmitSubblockWithBody(unsigned BlockID, unsigned CodeLen,
+                            ArrayRef<char> Body) {
+    assert(Body.size() % 4 == 0 && "Block body is not 32-bit aligned");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Emit(Body.size() / 4, bitc::BlockSizeWidth);
+    Out.append(Body.begin(), Body.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
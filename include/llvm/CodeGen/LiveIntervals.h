@@ -33,6 +33,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include <cassert>
 #include <cstdint>
+#include <memory>
 #include <utility>
 
 namespace llvm {
@@ -64,6 +65,10 @@ class VirtRegMap;
     /// Special pool allocator for VNInfo's (LiveInterval val#).
     VNInfo::Allocator VNInfoAllocator;
 
+    /// The VNInfo allocators of the tasks of computeVirtRegsInParallel(),
+    /// which own the values of the intervals it computed.
+    SmallVector<std::unique_ptr<VNInfo::Allocator>, 0> ParallelVNInfoAllocators;
+
     /// Live interval pointers for all the virtual registers.
     IndexedMap<LiveInterval*, VirtReg2IndexFunctor> VirtRegIntervals;
 
@@ -450,6 +455,9 @@ class VirtRegMap;
     /// Compute live intervals for all virtual registers.
     void computeVirtRegs();
 
+    /// Compute live intervals for all virtual registers on multiple threads.
+    void computeVirtRegsInParallel();
+
     /// Compute RegMaskSlots and RegMaskBits.
     void computeRegMasks();
 
@@ -79,6 +79,9 @@
  */
 #cmakedefine01 LLVM_FORCE_ENABLE_STATS
 
+/* Define to 1 to store no User pointer in Use, and to 0 otherwise */
+#cmakedefine01 LLVM_ENABLE_COMPACT_USES
+
 /* Define if we have z3 and want to build it */
 #cmakedefine LLVM_WITH_Z3 ${LLVM_WITH_Z3}
 
@@ -46,6 +46,7 @@ namespace llvm {
 class MCRegisterInfo;
 class MemoryBuffer;
 class raw_ostream;
+class ThreadPool;
 
 /// DWARFContext
 /// This data structure is the top level entity that deals with dwarf debug
@@ -68,6 +69,7 @@ class DWARFContext : public DIContext {
   std::unique_ptr<AppleAcceleratorTable> AppleTypes;
   std::unique_ptr<AppleAcceleratorTable> AppleNamespaces;
   std::unique_ptr<AppleAcceleratorTable> AppleObjC;
+  std::unique_ptr<StringMap<SmallVector<DWARFDie, 1>>> DIENames;
 
   DWARFUnitVector DWOUnits;
   std::unique_ptr<DWARFDebugAbbrev> AbbrevDWO;
@@ -97,6 +99,11 @@ class DWARFContext : public DIContext {
   /// and store them in NormalUnits.
   void parseNormalUnits();
 
+  /// Run \p Body, which processes units concurrently, while serializing the
+  /// calls to the error and warning handlers, so that the handlers need not
+  /// be thread-safe.
+  void withSerializedHandlers(function_ref<void()> Body);
+
   /// Read compile units from the debug_info.dwo section (if necessary)
   /// and type units from the debug_types.dwo section (if necessary)
   /// and store them in DWOUnits.
@@ -116,6 +123,9 @@ class DWARFContext : public DIContext {
   };
 
 public:
+  /// An index of DIEs by name, see getDIENameIndex().
+  using DIENameIndex = StringMap<SmallVector<DWARFDie, 1>>;
+
   DWARFContext(std::unique_ptr<const DWARFObject> DObj,
                std::string DWPName = "",
                std::function<void(Error)> RecoverableErrorHandler =
@@ -274,8 +284,29 @@ public:
   /// Get a pointer to the parsed dwo abbreviations object.
   const DWARFDebugAbbrev *getDebugAbbrevDWO();
 
-  /// Get a pointer to the parsed DebugAranges object.
-  const DWARFDebugAranges *getDebugAranges();
+  /// Get a pointer to the parsed DebugAranges object, building it on first
+  /// use. If \p Pool is not null, the address ranges of the units that are
+  /// not described by .debug_aranges are collected concurrently on it.
+  const DWARFDebugAranges *getDebugAranges(ThreadPool *Pool = nullptr);
+
+  /// Get the index of the DIEs of all normal and DWO units by name, building
+  /// it on first use. Each DIE is indexed under its short name and its
+  /// linkage name, and the DIEs for each name are in the order they appear in
+  /// the units. This is useful for name lookups in objects that lack
+  /// accelerator tables. If \p Pool is not null, the units are parsed and
+  /// indexed concurrently on it.
+  const DIENameIndex &getDIENameIndex(ThreadPool *Pool = nullptr);
+
+  /// Parse the DIEs of all normal and DWO units concurrently on \p Pool.
+  /// Once parsed, the DIEs of the units can be read from multiple threads.
+  /// The error and warning handlers are never called concurrently.
+  void parseAllUnitDIEs(ThreadPool &Pool);
+
+  /// Parse the DIEs of all normal and DWO units concurrently on the shared
+  /// llvm::parallel executor, which is sized by parallel::strategy. Unlike a
+  /// private thread pool, this bounds the total number of threads when
+  /// several contexts are parsed at the same time.
+  void parseAllUnitDIEs();
 
   /// Get a pointer to the parsed frame information object.
   Expected<const DWARFDebugFrame *> getDebugFrame();
@@ -17,10 +17,11 @@
 namespace llvm {
 
 class DWARFContext;
+class ThreadPool;
 
 class DWARFDebugAranges {
 public:
-  void generate(DWARFContext *CTX);
+  void generate(DWARFContext *CTX, ThreadPool *Pool = nullptr);
   uint64_t findAddress(uint64_t Address) const;
 
 private:
@@ -169,6 +169,31 @@ struct FunctionInfo {
                                              uint64_t FuncAddr,
                                              uint64_t Addr);
 
+  /// Lookup multiple addresses within a FunctionInfo object's data stream.
+  ///
+  /// This is equivalent to calling lookup() for each address, but decodes
+  /// the FunctionInfo header and the line table only once for all of the
+  /// addresses, and reuses \a LR for every result to avoid allocations.
+  ///
+  /// \param Data The binary stream to read the data from. This object must
+  /// have the data for the object starting at offset zero. The data
+  /// can contain more data than needed.
+  ///
+  /// \param GR The GSYM reader that contains the string and file table that
+  /// will be used to fill in information in the results.
+  ///
+  /// \param FuncAddr The function start address decoded from the GsymReader.
+  ///
+  /// \param Addrs The addresses to lookup, sorted in increasing order.
+  ///
+  /// \param LR Storage for the results passed to \a Callback.
+  ///
+  /// \param Callback Called once for each address, in order, with the index
+  /// of the address in \a Addrs.
+  static void lookup(DataExtractor &Data, const GsymReader &GR,
+                     uint64_t FuncAddr, ArrayRef<uint64_t> Addrs,
+                     LookupResult &LR, LookupCallback Callback);
+
   uint64_t startAddress() const { return Range.Start; }
   uint64_t endAddress() const { return Range.End; }
   uint64_t size() const { return Range.size(); }
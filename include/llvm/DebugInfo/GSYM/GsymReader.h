@@ -126,6 +126,24 @@ public:
   /// for failing to lookup the address.
   llvm::Expected<LookupResult> lookup(uint64_t Addr) const;
 
+  /// Lookup multiple addresses in the GSYM.
+  ///
+  /// This produces the same results as calling lookup() for each address,
+  /// but is much faster for large batches of addresses, like the ones a
+  /// symbolication server receives. The addresses are sorted so that the
+  /// address table is walked only once, and all of the addresses that fall
+  /// into the same function share a single decode of its FunctionInfo and
+  /// line table. A single LookupResult is reused for all of the results, so
+  /// no memory is allocated per address in the common case.
+  ///
+  /// \param Addrs The virtual addresses to lookup, in any order.
+  ///
+  /// \param Callback Called once for each address with the index of the
+  /// address in \a Addrs and the LookupResult for it, or an error object that
+  /// indicates the reason for failing to lookup the address. The callback is
+  /// invoked in order of increasing address, not in the order of \a Addrs.
+  void lookup(ArrayRef<uint64_t> Addrs, LookupCallback Callback) const;
+
   /// Get a string from the string table.
   ///
   /// \param Offset The string table offset for the string to retrieve.
@@ -256,12 +274,21 @@ protected:
   /// subtracting the gsym::Header::BaseAddress.
   /// \returns The matching address offset index. This index will be used to
   /// extract the FunctionInfo data's offset from the AddrInfoOffsets array.
+  ///
+  /// \param StartIndex An index at which to start the search. The address
+  /// offset at this index must be less than or equal to \a AddrOffset, which
+  /// is the case when \a AddrOffset is not less than an address offset that
+  /// was previously looked up to this index.
   template <class T>
-  llvm::Optional<uint64_t> getAddressOffsetIndex(const uint64_t AddrOffset) const {
+  llvm::Optional<uint64_t>
+  getAddressOffsetIndex(const uint64_t AddrOffset,
+                        size_t StartIndex = 0) const {
     ArrayRef<T> AIO = getAddrOffsets<T>();
     const auto Begin = AIO.begin();
     const auto End = AIO.end();
-    auto Iter = std::lower_bound(Begin, End, AddrOffset);
+    assert((StartIndex == 0 || AIO[StartIndex] <= AddrOffset) &&
+           "search must start at or before the address offset");
+    auto Iter = std::lower_bound(Begin + StartIndex, End, AddrOffset);
     // Watch for addresses that fall between the gsym::Header::BaseAddress and
     // the first address offset.
     if (Iter == Begin && AddrOffset < *Begin)
@@ -290,10 +317,13 @@ protected:
   ///
   /// \param Addr A virtual address that matches the original object file
   /// to lookup.
+  /// \param StartIndex An index into the address table at which to start the
+  /// search. See getAddressOffsetIndex().
   /// \returns An index into the address table. This index can be used to
   /// extract the FunctionInfo data's offset from the AddrInfoOffsets array.
   /// Returns an error if the address isn't in the GSYM with details of why.
-  Expected<uint64_t> getAddressIndex(const uint64_t Addr) const;
+  Expected<uint64_t> getAddressIndex(const uint64_t Addr,
+                                     size_t StartIndex = 0) const;
 
   /// Given an address index, get the offset for the FunctionInfo.
   ///
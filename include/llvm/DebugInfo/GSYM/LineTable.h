@@ -9,6 +9,7 @@
 #ifndef LLVM_DEBUGINFO_GSYM_LINETABLE_H
 #define LLVM_DEBUGINFO_GSYM_LINETABLE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/DebugInfo/GSYM/LineEntry.h"
 #include "llvm/Support/Error.h"
 #include <cstdint>
@@ -139,6 +140,29 @@ public:
   static Expected<LineEntry> lookup(DataExtractor &Data, uint64_t BaseAddr,
                                     uint64_t Addr);
 
+  /// Lookup multiple addresses within a line table's data.
+  ///
+  /// This is equivalent to calling lookup() for each address, but decodes
+  /// the line table only once, stopping as soon as the last address has been
+  /// matched.
+  ///
+  /// \param Data The binary stream to read the data from. This object must
+  /// have the data for the LineTable object starting at offset zero. The data
+  /// can contain more data than needed.
+  ///
+  /// \param BaseAddr The base address to use when decoding the line table.
+  ///
+  /// \param Addrs The addresses to lookup, sorted in increasing order.
+  ///
+  /// \param Entries An array with one element per address that will be
+  /// filled in with the matching LineEntry objects. Addresses that precede
+  /// the first row of the line table get an invalid LineEntry.
+  ///
+  /// \returns An error if the line table data could not be decoded.
+  static llvm::Error lookup(DataExtractor &Data, uint64_t BaseAddr,
+                            ArrayRef<uint64_t> Addrs,
+                            MutableArrayRef<LineEntry> Entries);
+
   /// Decode an LineTable object from a binary data stream.
   ///
   /// \param Data The binary stream to read the data from. This object must
@@ -10,7 +10,9 @@
 #define LLVM_DEBUGINFO_GSYM_LOOKUPRESULT_H
 
 #include "llvm/DebugInfo/GSYM/Range.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
 #include <inttypes.h>
 #include <vector>
 
@@ -57,6 +59,18 @@ struct LookupResult {
 
 raw_ostream &operator<<(raw_ostream &OS, const LookupResult &R);
 
+/// Callback used by the batched lookup functions to report the result for
+/// each address.
+///
+/// \param Index The index of the address in the array of addresses that was
+/// passed to the lookup function.
+///
+/// \param Result The result for the address, or an error. The referenced
+/// LookupResult is only valid for the duration of the callback and will be
+/// reused for later addresses, so clients that need to keep it must copy it.
+using LookupCallback =
+    function_ref<void(size_t Index, Expected<const LookupResult &> Result)>;
+
 } // namespace gsym
 } // namespace llvm
 
@@ -13,6 +13,7 @@
 #ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ObjectFile.h"
@@ -20,8 +21,10 @@
 #include "llvm/Support/Error.h"
 #include <algorithm>
 #include <cstdint>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -34,6 +37,12 @@ using namespace object;
 using FunctionNameKind = DILineInfoSpecifier::FunctionNameKind;
 using FileLineInfoKind = DILineInfoSpecifier::FileLineInfoKind;
 
+/// Symbolizes addresses in modules, caching the modules and their debug
+/// information between queries.
+///
+/// The symbolize* functions may be called concurrently from multiple threads.
+/// Queries for different modules run in parallel, while queries for the same
+/// module are serialized, as the debug info contexts are not thread-safe.
 class LLVMSymbolizer {
 public:
   struct Options {
@@ -49,6 +58,10 @@ public:
     std::string FallbackDebugPath;
     std::string DWPName;
     std::vector<std::string> DebugFileDirectory;
+    /// The maximum number of modules to keep cached. When this is exceeded,
+    /// the least recently used modules, and the object files that only they
+    /// use, are released. Zero means no limit.
+    size_t MaxCachedModules = 0;
   };
 
   LLVMSymbolizer() = default;
@@ -70,6 +83,8 @@ public:
   Expected<std::vector<DILocal>>
   symbolizeFrame(const std::string &ModuleName,
                  object::SectionedAddress ModuleOffset);
+  /// Releases all cached modules and object files. Must not be called while
+  /// other threads are symbolizing.
   void flush();
 
   static std::string
@@ -81,22 +96,61 @@ private:
   // corresponding debug info. These objects can be the same.
   using ObjectPair = std::pair<const ObjectFile *, const ObjectFile *>;
 
-  Expected<DILineInfo>
-  symbolizeCodeCommon(SymbolizableModule *Info,
-                      object::SectionedAddress ModuleOffset);
+  /// A cache entry for a module.
+  struct CachedModule {
+    /// The module, or null if loading it failed.
+    std::unique_ptr<SymbolizableModule> Module;
+    /// The object files the module was created from.
+    ObjectPair Objects;
+    /// The key of this entry in Modules.
+    StringRef Name;
+    /// Serializes the queries to Module.
+    std::mutex QueryMutex;
+    /// The number of queries using the module. Modules that are in use are
+    /// not evicted.
+    unsigned Users = 0;
+    /// The position of this entry in ModulesLRU.
+    std::list<CachedModule *>::iterator LRUPos;
+  };
+
+  DILineInfo symbolizeCodeCommon(SymbolizableModule *Info,
+                                 object::SectionedAddress ModuleOffset);
+
+  /// Runs \p Query on the module returned by getOrCreateModuleInfo() while
+  /// holding its query lock, then releases the module.
+  template <typename T>
+  Expected<T> queryModule(Expected<CachedModule *> ModOrErr,
+                          function_ref<T(SymbolizableModule *)> Query);
 
-  /// Returns a SymbolizableModule or an error if loading debug info failed.
+  /// Returns the cache entry for a module, marking it as in use until it is
+  /// passed to releaseModule(), or an error if loading debug info failed.
   /// Only one attempt is made to load a module, and errors during loading are
   /// only reported once. Subsequent calls to get module info for a module that
-  /// failed to load will return nullptr.
-  Expected<SymbolizableModule *>
+  /// failed to load will return an entry with a null module.
+  Expected<CachedModule *>
   getOrCreateModuleInfo(const std::string &ModuleName);
 
-  Expected<SymbolizableModule *>
-  createModuleInfo(const ObjectFile *Obj,
-                   std::unique_ptr<DIContext> Context,
+  Expected<CachedModule *>
+  createModuleInfo(ObjectPair Objects, std::unique_ptr<DIContext> Context,
                    StringRef ModuleName);
 
+  /// Returns the cache entry for \p ModuleName, marked as in use, or null if
+  /// the module is not cached.
+  CachedModule *lookUpModule(StringRef ModuleName);
+
+  /// Adds an entry for \p ModuleName to the cache, evicting the least recently
+  /// used entries if the cache is full. Must be called with LoadMutex held.
+  CachedModule *insertModule(StringRef ModuleName,
+                             std::unique_ptr<SymbolizableModule> Module,
+                             ObjectPair Objects, bool MarkInUse);
+
+  /// Marks a module returned by getOrCreateModuleInfo() as no longer in use.
+  void releaseModule(CachedModule *Mod);
+
+  /// Releases the object files and binaries that are not used by any cached
+  /// module. Must be called with LoadMutex and ModulesMutex held.
+  void releaseUnusedObjects();
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -117,8 +171,17 @@ private:
   Expected<ObjectFile *> getOrCreateObject(const std::string &Path,
                                           const std::string &ArchName);
 
-  std::map<std::string, std::unique_ptr<SymbolizableModule>, std::less<>>
-      Modules;
+  /// Serializes the loading of modules, and guards the object file caches
+  /// below. Always acquired before ModulesMutex.
+  std::mutex LoadMutex;
+
+  /// Guards Modules, ModulesLRU and the Users counts of the cached modules.
+  std::mutex ModulesMutex;
+
+  std::map<std::string, std::unique_ptr<CachedModule>, std::less<>> Modules;
+
+  /// The cached modules, from the most to the least recently used.
+  std::list<CachedModule *> ModulesLRU;
 
   /// Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
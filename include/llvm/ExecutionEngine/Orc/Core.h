@@ -20,7 +20,9 @@
 #include "llvm/ExecutionEngine/Orc/SymbolStringPool.h"
 #include "llvm/ExecutionEngine/OrcV1Deprecation.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/RWMutex.h"
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -1041,6 +1043,17 @@ private:
 
   Error emit(const SymbolFlagsMap &Emitted);
 
+  /// Record that the symbol table entry SymI has reached the Ready state.
+  /// Must be called with the session lock held.
+  void addToReadySymbolsCache(SymbolTable::iterator SymI);
+
+  /// Look up Name in the cache of Ready symbols. This does not take the
+  /// session lock. Returns None if Name is not Ready in this JITDylib or is not
+  /// visible under JDLookupFlags.
+  Optional<JITEvaluatedSymbol>
+  lookupReadySymbol(const SymbolStringPtr &Name,
+                    JITDylibLookupFlags JDLookupFlags) const;
+
   using FailedSymbolsWorklist =
       std::vector<std::pair<JITDylib *, SymbolStringPtr>>;
   static void notifyFailed(FailedSymbolsWorklist FailedSymbols);
@@ -1053,6 +1066,12 @@ private:
   MaterializingInfosMap MaterializingInfos;
   std::vector<std::unique_ptr<DefinitionGenerator>> DefGenerators;
   JITDylibSearchOrder LinkOrder;
+
+  // Copy of the Ready symbols in Symbols, which lets lookups of already
+  // materialized symbols complete without contending on the session lock.
+  // Only updated with the session lock held.
+  mutable sys::SmartRWMutex<true> ReadySymbolsCacheMutex;
+  SymbolMap ReadySymbolsCache;
 };
 
 /// Platforms set up standard symbols and mediate interactions between dynamic
@@ -1148,9 +1167,7 @@ public:
   Expected<JITDylib &> createJITDylib(std::string Name);
 
   /// Allocate a module key for a new module to add to the JIT.
-  VModuleKey allocateVModule() {
-    return runSessionLocked([this]() { return ++LastKey; });
-  }
+  VModuleKey allocateVModule() { return ++LastKey; }
 
   /// Return a module key to the ExecutionSession so that it can be
   ///        re-used. This should only be done once all resources associated
@@ -1271,6 +1288,9 @@ private:
 
   void runOutstandingMUs();
 
+  Optional<SymbolMap> lookupReadySymbols(const JITDylibSearchOrder &SearchOrder,
+                                         const SymbolLookupSet &Symbols);
+
 #ifndef NDEBUG
   void dumpDispatchInfo(JITDylib &JD, MaterializationUnit &MU);
 #endif // NDEBUG
@@ -1278,7 +1298,7 @@ private:
   mutable std::recursive_mutex SessionMutex;
   std::shared_ptr<SymbolStringPool> SSP;
   std::unique_ptr<Platform> P;
-  VModuleKey LastKey = 0;
+  std::atomic<VModuleKey> LastKey{0};
   ErrorReporter ReportError = logErrorsToStdErr;
   DispatchMaterializationFunction DispatchMaterialization =
       materializeOnCurrentThread;
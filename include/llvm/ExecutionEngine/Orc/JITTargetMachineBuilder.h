@@ -76,6 +76,9 @@ public:
     return *this;
   }
 
+  /// Get the CPU string.
+  const std::string &getCPU() const { return CPU; }
+
   /// Set the relocation model.
   JITTargetMachineBuilder &setRelocationModel(Optional<Reloc::Model> RM) {
     this->RM = std::move(RM);
@@ -100,6 +103,9 @@ public:
     return *this;
   }
 
+  /// Get the LLVM CodeGen optimization level.
+  CodeGenOpt::Level getCodeGenOptLevel() const { return OptLevel; }
+
   /// Set subtarget features.
   JITTargetMachineBuilder &setFeatures(StringRef FeatureString) {
     Features = SubtargetFeatures(FeatureString);
@@ -271,6 +271,7 @@ public:
   ObjectLinkingLayerCreator CreateObjectLinkingLayer;
   CompileFunctionCreator CreateCompileFunction;
   PlatformSetupFunction SetUpPlatform;
+  ObjectCache *ObjCache = nullptr;
   unsigned NumCompileThreads = 0;
 
   /// Called prior to JIT class construcion to fix up defaults.
@@ -341,6 +342,17 @@ public:
     return impl();
   }
 
+  /// Set an ObjectCache to be queried before compiling each module, e.g. a
+  /// LocalObjectCache to reuse objects compiled by previous JIT sessions.
+  ///
+  /// The cache is only used by the default compile function; clients setting
+  /// a CompileFunctionCreator are responsible for configuring their compiler.
+  /// The cache must outlive the JIT instance.
+  SetterImpl &setObjectCache(ObjectCache *ObjCache) {
+    impl().ObjCache = ObjCache;
+    return impl();
+  }
+
   /// Set the number of compile threads to use.
   ///
   /// If set to zero, compilation will be performed on the execution thread when
@@ -0,0 +1,92 @@
+//===- LocalObjectCache.h - Persistent on-disk cache for ORC ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that stores compiled objects in a directory on disk so that
+// they survive across JIT sessions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_LOCALOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_LOCALOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Error.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+
+class Module;
+
+namespace orc {
+
+class JITTargetMachineBuilder;
+
+/// A content-addressed, on-disk ObjectCache.
+///
+/// Objects are keyed by a hash of the module's bitcode together with a
+/// client-supplied key prefix, which must describe everything else that
+/// affects code generation (target triple, CPU, features, optimization level,
+/// etc.). Entries are named like those of the LTO cache, so the cache
+/// directory can be pruned with llvm::pruneCache() or prune().
+///
+/// The cache may be shared between compile threads, e.g. by passing it to a
+/// ConcurrentIRCompiler or to LLJITBuilder::setObjectCache. Failures to read
+/// or write cache entries are not fatal: the module is simply recompiled.
+class LocalObjectCache : public ObjectCache {
+public:
+  /// Create a cache storing its entries in \p CacheDir, creating the directory
+  /// if necessary.
+  static Expected<std::unique_ptr<LocalObjectCache>>
+  Create(StringRef CacheDir, StringRef KeyPrefix);
+
+  /// Create a cache storing its entries in \p CacheDir, using a key prefix
+  /// derived from the configuration of \p JTMB.
+  static Expected<std::unique_ptr<LocalObjectCache>>
+  Create(StringRef CacheDir, const JITTargetMachineBuilder &JTMB);
+
+  /// Returns a key prefix describing the target machines built by \p JTMB.
+  static std::string getKeyPrefix(const JITTargetMachineBuilder &JTMB);
+
+  /// Returns the key identifying the object for \p M in this cache.
+  std::string getKey(const Module &M) const;
+
+  /// Returns the path of the cache directory.
+  StringRef getCacheDir() const { return CacheDir; }
+
+  /// Prune the cache directory according to \p Policy. Returns false if the
+  /// policy could not be applied.
+  bool prune(const CachePruningPolicy &Policy);
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+private:
+  LocalObjectCache(StringRef CacheDir, StringRef KeyPrefix)
+      : CacheDir(CacheDir), KeyPrefix(KeyPrefix) {}
+
+  std::string getEntryPath(StringRef Key) const;
+
+  std::string CacheDir;
+  std::string KeyPrefix;
+
+  // Keys computed by getObject for modules that missed in the cache, so that
+  // the following notifyObjectCompiled call does not hash the module again.
+  std::mutex PendingKeysMutex;
+  DenseMap<const Module *, std::string> PendingKeys;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_LOCALOBJECTCACHE_H
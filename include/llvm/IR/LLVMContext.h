@@ -146,6 +146,16 @@ public:
   /// especially in release mode.
   void setDiscardValueNames(bool Discard);
 
+  /// Return true if the memory of every bitcode buffer read into this context
+  /// is known to outlive it.
+  bool doesBitcodeOutliveContext() const;
+
+  /// Promise that the memory of every bitcode buffer read into this context
+  /// outlives it. The bitcode reader then has metadata strings refer to the
+  /// buffer instead of copying them into the context, which saves memory and
+  /// load time in tools that read large amounts of bitcode to inspect it.
+  void setBitcodeOutlivesContext(bool Outlives);
+
   /// Whether there is a string map for uniquing debug info
   /// identifiers across the context.  Off by default.
   bool isODRUniquingDebugTypes() const;
@@ -600,23 +600,40 @@ dyn_extract_or_null(Y &&MD) {
 /// These are used to efficiently contain a byte sequence for metadata.
 /// MDString is always unnamed.
 class MDString : public Metadata {
-  friend class StringMapEntryStorage<MDString>;
+  friend struct MDStringTable;
 
-  StringMapEntry<MDString> *Entry = nullptr;
+  StringRef Str;
 
-  MDString() : Metadata(MDStringKind, Uniqued) {}
+  MDString(StringRef Str, unsigned Hash)
+      : Metadata(MDStringKind, Uniqued), Str(Str) {
+    SubclassData32 = Hash;
+  }
+
+  unsigned getHash() const { return SubclassData32; }
+
+  static MDString *getImpl(LLVMContext &Context, StringRef Str,
+                           bool IsExternal);
 
 public:
   MDString(const MDString &) = delete;
   MDString &operator=(MDString &&) = delete;
   MDString &operator=(const MDString &) = delete;
 
-  static MDString *get(LLVMContext &Context, StringRef Str);
+  static MDString *get(LLVMContext &Context, StringRef Str) {
+    return getImpl(Context, Str, /*IsExternal=*/false);
+  }
   static MDString *get(LLVMContext &Context, const char *Str) {
     return get(Context, Str ? StringRef(Str) : StringRef());
   }
 
-  StringRef getString() const;
+  /// Like get(), but if the string isn't in the context yet, the new MDString
+  /// refers to the characters of \p Str instead of a copy of them. They must
+  /// outlive the context.
+  static MDString *getExternal(LLVMContext &Context, StringRef Str) {
+    return getImpl(Context, Str, /*IsExternal=*/true);
+  }
+
+  StringRef getString() const { return Str; }
 
   unsigned getLength() const { return (unsigned)getString().size(); }
 
@@ -17,8 +17,10 @@
 
 #include "llvm/ADT/Any.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/PerfEventCounters.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/TypeName.h"
 #include <memory>
@@ -41,11 +43,17 @@ Timer *getPassTimer(Pass *);
 /// This is the storage for the -time-passes option.
 extern bool TimePassesIsEnabled;
 
+/// If the user specifies the -time-passes-perf-counters argument, the new pass
+/// manager's -time-passes report also includes hardware event counts.
+extern bool TimePassesPerfCountersEnabled;
+
 /// This class implements -time-passes functionality for new pass manager.
 /// It provides the pass-instrumentation callbacks that measure the pass
 /// execution time. They collect timing info into individual timers as
 /// passes are being run. At the end of its life-time it prints the resulting
-/// timing report.
+/// timing report. If requested and available, it also counts hardware events
+/// (cycles, instructions, cache misses and branch misses) by pass and by
+/// function, for the passes that run on functions.
 class TimePassesHandler {
   /// Value of this type is capable of uniquely identifying pass invocations.
   /// It is a pair of string Pass-Identifier (which for now is common
@@ -69,8 +77,22 @@ class TimePassesHandler {
 
   bool Enabled;
 
+  using EventCounts = PerfEventCounters::Values;
+
+  /// Hardware event counters, if requested and available.
+  std::unique_ptr<PerfEventCounters> Counters;
+
+  /// Event counts accumulated by pass and by function.
+  StringMap<EventCounts> PassCounts;
+  StringMap<EventCounts> FunctionCounts;
+
+  /// Event counts at the start of the currently running passes, with the name
+  /// of the function they run on, if any.
+  SmallVector<std::pair<EventCounts, std::string>, 8> CountsStack;
+
 public:
-  TimePassesHandler(bool Enabled = TimePassesIsEnabled);
+  TimePassesHandler(bool Enabled = TimePassesIsEnabled,
+                    bool PerfCounters = TimePassesPerfCountersEnabled);
 
   /// Destructor handles the print action if it has not been handled before.
   ~TimePassesHandler() { print(); }
@@ -97,8 +119,12 @@ private:
   void startTimer(StringRef PassID);
   void stopTimer(StringRef PassID);
 
+  void startCounters(Any IR);
+  void stopCounters(StringRef PassID);
+  void printCounts(raw_ostream &OS);
+
   // Implementation of pass instrumentation callbacks.
-  bool runBeforePass(StringRef PassID);
+  bool runBeforePass(StringRef PassID, Any IR);
   void runAfterPass(StringRef PassID);
 };
 
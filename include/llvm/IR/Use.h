@@ -11,11 +11,13 @@
 /// instruction or some other User instance which refers to a Value.  The Use
 /// class keeps the "use list" of the referenced value up to date.
 ///
-/// Pointer tagging is used to efficiently find the User corresponding to a Use
-/// without having to store a User pointer in every Use. A User is preceded in
-/// memory by all the Uses corresponding to its operands, and the low bits of
-/// one of the fields (Prev) of the Use class are used to encode offsets to be
-/// able to find that User given a pointer to any Use. For details, see:
+/// Each Use stores a pointer to its User, unless LLVM is built with
+/// LLVM_ENABLE_COMPACT_USES. Then pointer tagging is used to find the User
+/// corresponding to a Use without having to store a User pointer in every Use.
+/// A User is preceded in memory by all the Uses corresponding to its operands,
+/// and the low bits of one of the fields (Prev) of the Use class are used to
+/// encode offsets to be able to find that User given a pointer to any Use. For
+/// details, see:
 ///
 ///   http://www.llvm.org/docs/ProgrammersManual.html#UserLayout
 ///
@@ -26,6 +28,7 @@
 
 #include "llvm-c/Types.h"
 #include "llvm/ADT/PointerIntPair.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Compiler.h"
 
@@ -56,13 +59,33 @@ private:
       removeFromList();
   }
 
+#if LLVM_ENABLE_COMPACT_USES
+  /// The tags stored in the low bits of Prev. Walking the Uses of a User
+  /// towards its end, the digits between two stop tags spell the distance
+  /// from the second stop tag to the end, which is the User itself or, for
+  /// hung off uses, a UserRef pointing to it.
+  enum PrevPtrTag { zeroDigitTag, oneDigitTag, stopTag, fullStopTag };
+
+  /// Constructor
+  Use(PrevPtrTag Tag) { Prev.setInt(Tag); }
+#else
   /// Constructor
   Use(User *Parent) : Parent(Parent) {}
+#endif
 
 public:
   friend class Value;
   friend class User;
 
+#if LLVM_ENABLE_COMPACT_USES
+  /// A tagged pointer to the User of hung off uses, stored right after them.
+  using UserRef = PointerIntPair<User *, 1, unsigned>;
+
+  /// Initializes the tags of the Uses in [\p Start, \p Stop), so that they
+  /// lead to \p Stop, and returns \p Start.
+  static Use *initTags(Use *Start, Use *Stop);
+#endif
+
   operator Value *() const { return Val; }
   Value *get() const { return Val; }
 
@@ -70,7 +93,11 @@ public:
   ///
   /// For an instruction operand, for example, this will return the
   /// instruction.
+#if LLVM_ENABLE_COMPACT_USES
+  User *getUser() const;
+#else
   User *getUser() const { return Parent; };
+#endif
 
   inline void set(Value *Val);
 
@@ -93,21 +120,35 @@ private:
 
   Value *Val = nullptr;
   Use *Next = nullptr;
+#if LLVM_ENABLE_COMPACT_USES
+  PointerIntPair<Use **, 2, PrevPtrTag> Prev;
+
+  /// Returns the end of the Uses this one belongs to.
+  const Use *getImpliedUser() const;
+
+  Use **getPrev() const { return Prev.getPointer(); }
+  void setPrev(Use **NewPrev) { Prev.setPointer(NewPrev); }
+#else
   Use **Prev = nullptr;
   User *Parent = nullptr;
 
+  Use **getPrev() const { return Prev; }
+  void setPrev(Use **NewPrev) { Prev = NewPrev; }
+#endif
+
   void addToList(Use **List) {
     Next = *List;
     if (Next)
-      Next->Prev = &Next;
-    Prev = List;
-    *Prev = this;
+      Next->setPrev(&Next);
+    setPrev(List);
+    *List = this;
   }
 
   void removeFromList() {
-    *Prev = Next;
+    Use **StrippedPrev = getPrev();
+    *StrippedPrev = Next;
     if (Next)
-      Next->Prev = Prev;
+      Next->setPrev(StrippedPrev);
   }
 };
 
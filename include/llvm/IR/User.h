@@ -90,6 +90,17 @@ protected:
   /// should be called if there are no uses.
   void growHungoffUses(unsigned N, bool IsPhi = false);
 
+  /// Returns the start of the N BasicBlock* that allocHungoffUses allocates
+  /// along with the \p N hung off uses starting at \p Ops, for phi nodes.
+  static void *getHungoffPhiBlocks(const Use *Ops, unsigned N) {
+#if LLVM_ENABLE_COMPACT_USES
+    return const_cast<Use::UserRef *>(
+               reinterpret_cast<const Use::UserRef *>(Ops + N)) + 1;
+#else
+    return const_cast<Use *>(Ops + N);
+#endif
+  }
+
 protected:
   ~User() = default; // Use deleteValue() to delete a generic Instruction.
 
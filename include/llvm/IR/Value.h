@@ -839,7 +839,7 @@ template <class Compare> void Value::sortUseList(Compare Cmp) {
 
   // Fix the Prev pointers.
   for (Use *I = UseList, **Prev = &UseList; I; I = I->Next) {
-    I->Prev = Prev;
+    I->setPrev(Prev);
     Prev = &I->Next;
   }
 }
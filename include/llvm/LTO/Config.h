@@ -59,6 +59,21 @@ struct Config {
   /// Disable entirely the optimizer, including importing for ThinLTO
   bool CodeGenOnly = false;
 
+  /// If this field is set, the ThinLTO cache key of a module depends on the
+  /// content it imports from other modules rather than on the whole of those
+  /// modules, so that editing a function does not invalidate the cache entries
+  /// of the modules that import from its module but not the function itself.
+  /// This requires performing the import before each cache lookup.
+  bool ThinLTOCacheImportedContent = false;
+
+  /// If this field is set, the metadata of regular LTO modules is loaded
+  /// on-demand: only the named metadata and the nodes reachable from it are
+  /// loaded when a module is added, and other nodes, such as the debug info
+  /// of function bodies, are loaded when the IR mover materializes the global
+  /// that references them. Metadata only used by globals that are not linked
+  /// into the combined module is never loaded.
+  bool RegularLTOLazyMetadata = false;
+
   /// Run PGO context sensitive IR instrumentation.
   bool RunCSIRInstr = false;
 
@@ -139,6 +154,13 @@ struct Config {
   /// Time trace granularity.
   unsigned TimeTraceGranularity = 500;
 
+  /// Maximum number of time trace entries kept per thread, or 0 for no limit.
+  unsigned TimeTraceMaxEntries = 0;
+
+  /// Record only one in every TimeTraceSampleInterval outermost time trace
+  /// sections of each thread.
+  unsigned TimeTraceSampleInterval = 1;
+
   bool ShouldDiscardValueNames = true;
   DiagnosticHandlerFunction DiagHandler;
 
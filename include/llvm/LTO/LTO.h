@@ -61,7 +61,9 @@ void thinLTOInternalizeAndPromoteInIndex(
 
 /// Computes a unique hash for the Module considering the current list of
 /// export/import and other global analysis results.
-/// The hash is produced in \p Key.
+/// The hash is produced in \p Key. If \p ImportsHash is not null, it is used
+/// in place of the hashes of the modules in \p ImportList, see
+/// lto::computeImportsHash().
 void computeLTOCacheKey(
     SmallString<40> &Key, const lto::Config &Conf,
     const ModuleSummaryIndex &Index, StringRef ModuleID,
@@ -70,7 +72,8 @@ void computeLTOCacheKey(
     const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
     const GVSummaryMapTy &DefinedGlobals,
     const std::set<GlobalValue::GUID> &CfiFunctionDefs = {},
-    const std::set<GlobalValue::GUID> &CfiFunctionDecls = {});
+    const std::set<GlobalValue::GUID> &CfiFunctionDecls = {},
+    const ModuleHash *ImportsHash = nullptr);
 
 namespace lto {
 
@@ -46,6 +46,17 @@ Error thinBackend(const Config &C, unsigned Task, AddStreamFn AddStream,
                   const GVSummaryMapTy &DefinedGlobals,
                   MapVector<StringRef, BitcodeModule> &ModuleMap);
 
+/// Computes a hash of the content that the ThinLTO backend for \p BM imports
+/// from other modules according to \p ImportList. The import is performed
+/// into an empty module, which is then hashed, so the result only changes if
+/// the imported functions, variables, or the declarations and metadata they
+/// reference change.
+Expected<ModuleHash>
+computeImportsHash(const Config &C, BitcodeModule &BM,
+                   const ModuleSummaryIndex &CombinedIndex,
+                   const FunctionImporter::ImportMapTy &ImportList,
+                   MapVector<StringRef, BitcodeModule> &ModuleMap);
+
 Error finalizeOptimizationRemarks(
     std::unique_ptr<ToolOutputFile> DiagOutputFile);
 }
@@ -154,6 +154,9 @@ private:
 
   VersionInfoType VersionInfo;
 
+  /// Tracks which fragments have to be relaxed again during layout.
+  class RelaxationWorklist;
+
   /// Evaluate a fixup to a relocatable expression and the value which should be
   /// placed into the fixup.
   ///
@@ -182,13 +185,15 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
-  /// Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  /// Perform one layout iteration over the fragments pending in \p Worklist
+  /// and return true if any fragments are still pending.
+  bool layoutOnce(MCAsmLayout &Layout, RelaxationWorklist &Worklist);
 
-  /// Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec);
+  /// Perform one layout iteration over the fragments of the given section
+  /// that are pending in \p Worklist and return true if any fragments of the
+  /// section are still pending.
+  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                         RelaxationWorklist &Worklist);
 
   /// Perform relaxation on a single fragment - returns true if the fragment
   /// changes as a result of relaxation.
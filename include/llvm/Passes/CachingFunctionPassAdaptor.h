@@ -0,0 +1,90 @@
+//===- CachingFunctionPassAdaptor.h ----------------------------*- C++ -*--===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This header defines a module pass adaptor that runs a function pass
+/// pipeline over the functions of a module, reusing the optimized bodies of
+/// functions that haven't changed since an earlier run from an on-disk cache.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PASSES_CACHINGFUNCTIONPASSADAPTOR_H
+#define LLVM_PASSES_CACHINGFUNCTIONPASSADAPTOR_H
+
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/ParallelFunctionPassAdaptor.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CachePruning.h"
+
+#include <string>
+
+namespace llvm {
+
+class Module;
+class TargetMachine;
+
+/// Runs a function pass pipeline over every function in a module, reusing
+/// the results of earlier runs for functions that haven't changed.
+///
+/// Every function is optimized on its own, in a module that holds just the
+/// function and the context it depends on: the data layout, triple and flags
+/// of the module, declarations of the functions and variables it refers to,
+/// with their attributes, and the initializers of the constants it refers to.
+/// That module is what the cache key is computed from, together with the
+/// linkage of the global values it refers to, the pipeline, and the target.
+/// Because the pipeline never sees anything else, a body found in the cache is
+/// exactly what running the pipeline would produce again. Bodies are merged
+/// back the same way \c ParallelModuleToFunctionPassAdaptor merges them, so
+/// the same restrictions apply; in addition, options that change the behavior
+/// of passes behind the back of the pipeline text, such as most \c cl::opt
+/// flags, are not part of the key.
+///
+/// Functions that have the address of one of their blocks taken, or that have
+/// metadata referring to global values, are run through \p InPlacePass and
+/// never cached, exactly as \c ModuleToFunctionPassAdaptor would run them.
+///
+/// Cache entries are named "llvmcache-<key>". After every run, the directory
+/// is pruned with \c pruneCache() according to \p Policy.
+class CachingModuleToFunctionPassAdaptor
+    : public PassInfoMixin<CachingModuleToFunctionPassAdaptor> {
+public:
+  using PipelineBuilderT =
+      ParallelModuleToFunctionPassAdaptor::PipelineBuilderT;
+
+  /// \p PipelineKey identifies the passes \p BuildPipeline adds, typically
+  /// their textual description; it is part of every cache key. \p TM and
+  /// \p PTO configure the \c PassBuilder the pipeline is built with.
+  CachingModuleToFunctionPassAdaptor(FunctionPassManager InPlacePass,
+                                     PipelineBuilderT BuildPipeline,
+                                     std::string PipelineKey,
+                                     std::string CacheDir,
+                                     TargetMachine *TM = nullptr,
+                                     PipelineTuningOptions PTO =
+                                         PipelineTuningOptions(),
+                                     CachePruningPolicy Policy =
+                                         CachePruningPolicy())
+      : InPlacePass(std::move(InPlacePass)),
+        BuildPipeline(std::move(BuildPipeline)),
+        PipelineKey(std::move(PipelineKey)), CacheDir(std::move(CacheDir)),
+        TM(TM), PTO(PTO), Policy(Policy) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  FunctionPassManager InPlacePass;
+  PipelineBuilderT BuildPipeline;
+  std::string PipelineKey;
+  std::string CacheDir;
+  TargetMachine *TM;
+  PipelineTuningOptions PTO;
+  CachePruningPolicy Policy;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PASSES_CACHINGFUNCTIONPASSADAPTOR_H
@@ -0,0 +1,88 @@
+//===- ParallelFunctionPassAdaptor.h ---------------------------*- C++ -*--===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This header defines a module pass adaptor that runs a function pass
+/// pipeline over the functions of a module on several threads.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PASSES_PARALLELFUNCTIONPASSADAPTOR_H
+#define LLVM_PASSES_PARALLELFUNCTIONPASSADAPTOR_H
+
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Error.h"
+
+#include <functional>
+
+namespace llvm {
+
+class Module;
+class TargetMachine;
+
+/// Runs a function pass pipeline over every function in a module, spreading
+/// the functions across a pool of threads.
+///
+/// IR within one LLVMContext can't be modified concurrently, so the threads
+/// don't share the module. It is written to bitcode once, and each thread
+/// loads the bodies of its share of the functions into a context of its own,
+/// builds the pipeline with its own \c PassBuilder and analysis managers, runs
+/// it, and writes the result back to bitcode. The optimized bodies are then
+/// moved into the original functions on the calling thread. That is also
+/// where the module-level side effects of the passes are resolved:
+/// declarations and globals they created are added to the module, and types
+/// and distinct metadata nodes are mapped back to the originals.
+///
+/// This comes with some restrictions compared to \c
+/// ModuleToFunctionPassAdaptor:
+/// - The passes see the other functions of the module only as declarations,
+///   and module analyses are never cached on the worker threads.
+/// - Pass instrumentation and pass plugins are not available on the worker
+///   threads, and the pipeline is built with the default alias analyses.
+/// - Changes to anything but the body, personality and metadata attachments
+///   of the function being optimized are dropped.
+///
+/// Functions that have the address of one of their blocks taken, and all
+/// functions if only one thread is available, are run through \p SerialPass
+/// on the calling thread instead, exactly as \c ModuleToFunctionPassAdaptor
+/// would run them.
+class ParallelModuleToFunctionPassAdaptor
+    : public PassInfoMixin<ParallelModuleToFunctionPassAdaptor> {
+public:
+  /// Adds the passes to run to \p FPM, constructing them with \p PB. This is
+  /// called once on every worker thread, so it must not have side effects.
+  using PipelineBuilderT =
+      std::function<Error(PassBuilder &PB, FunctionPassManager &FPM)>;
+
+  /// \p TM and \p PTO configure the \c PassBuilder of each worker thread; the
+  /// target machine is cloned for every thread. A \p Threads value of zero
+  /// uses all available hardware threads.
+  ParallelModuleToFunctionPassAdaptor(FunctionPassManager SerialPass,
+                                      PipelineBuilderT BuildPipeline,
+                                      TargetMachine *TM = nullptr,
+                                      PipelineTuningOptions PTO =
+                                          PipelineTuningOptions(),
+                                      unsigned Threads = 0)
+      : SerialPass(std::move(SerialPass)),
+        BuildPipeline(std::move(BuildPipeline)), TM(TM), PTO(PTO),
+        Threads(Threads) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  FunctionPassManager SerialPass;
+  PipelineBuilderT BuildPipeline;
+  TargetMachine *TM;
+  PipelineTuningOptions PTO;
+  unsigned Threads;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PASSES_PARALLELFUNCTIONPASSADAPTOR_H
@@ -476,6 +476,16 @@ public:
   /// If the sequence of passes aren't all the exact same kind of pass, it will
   /// be an error. You cannot mix different levels implicitly, you must
   /// explicitly form a pass manager in which to nest passes.
+  ///
+  /// A function pipeline can be spread across threads by nesting it in
+  /// `parallel-function(...)` instead of `function(...)`, or in
+  /// `parallel-function<N>(...)` to use N threads. See \c
+  /// ParallelModuleToFunctionPassAdaptor for the restrictions that apply.
+  /// Nesting it in `cached-function(...)` instead reuses the optimized bodies
+  /// of functions that didn't change since an earlier run from the directory
+  /// given with `-function-cache-dir`, which is pruned according to
+  /// `-function-cache-policy`. See \c CachingModuleToFunctionPassAdaptor for
+  /// how unchanged functions are found.
   Error parsePassPipeline(ModulePassManager &MPM, StringRef PipelineText,
                           bool VerifyEachPass = true,
                           bool DebugLogging = false);
@@ -28,6 +28,11 @@ namespace parallel {
 // initialized before the first use of parallel routines.
 extern ThreadPoolStrategy strategy;
 
+/// Scheduling hint for tasks spawned into a TaskGroup. High priority tasks are
+/// picked up by idle workers before any normal priority work, which is useful
+/// for tasks on the critical path (e.g. the producer stage of a pipeline).
+enum class TaskPriority { Normal, High };
+
 namespace detail {
 
 #if LLVM_ENABLE_THREADS
@@ -52,23 +57,45 @@ public:
       Cond.notify_all();
   }
 
+  bool isDone() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Count == 0;
+  }
+
   void sync() const {
     std::unique_lock<std::mutex> lock(Mutex);
     Cond.wait(lock, [&] { return Count == 0; });
   }
+
+  /// Waits until the count drops to zero or \p Wake returns true. \p Wake is
+  /// checked with the latch locked, so whoever makes it true and then calls
+  /// notify() is sure to wake the waiter.
+  template <typename Predicate> void syncOr(Predicate Wake) const {
+    std::unique_lock<std::mutex> lock(Mutex);
+    Cond.wait(lock, [&] { return Count == 0 || Wake(); });
+  }
+
+  void notify() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Cond.notify_all();
+  }
 };
 
+/// A group of tasks run on the default executor. TaskGroups may be nested:
+/// a worker thread waiting for a group to finish runs other pending tasks
+/// instead of blocking, so nested parallel algorithms cannot starve the
+/// executor. It only sleeps while there is no task to run.
 class TaskGroup {
   Latch L;
-  bool Parallel;
 
 public:
-  TaskGroup();
+  TaskGroup() = default;
   ~TaskGroup();
 
-  void spawn(std::function<void()> f);
+  void spawn(std::function<void()> f,
+             TaskPriority Priority = TaskPriority::Normal);
 
-  void sync() const { L.sync(); }
+  void sync() const;
 };
 
 const ptrdiff_t MinParallelSize = 1024;
@@ -0,0 +1,66 @@
+//===- llvm/Support/PerfEventCounters.h - Hardware counters -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a small wrapper around the Linux perf_event interface
+// that counts a fixed set of hardware events for the calling thread.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PERFEVENTCOUNTERS_H
+#define LLVM_SUPPORT_PERFEVENTCOUNTERS_H
+
+#include "llvm/ADT/StringRef.h"
+#include <array>
+#include <cstdint>
+
+namespace llvm {
+
+/// Counts hardware events for the thread that created it, as long as it is
+/// alive. The counters are only available on Linux, when the kernel allows
+/// user space to monitor the thread (see /proc/sys/kernel/perf_event_paranoid);
+/// otherwise isValid() returns false and all the counts are zero.
+class PerfEventCounters {
+public:
+  enum EventKind {
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    NumEventKinds
+  };
+
+  using Values = std::array<uint64_t, NumEventKinds>;
+
+  PerfEventCounters();
+  ~PerfEventCounters();
+
+  PerfEventCounters(const PerfEventCounters &) = delete;
+  PerfEventCounters &operator=(const PerfEventCounters &) = delete;
+
+  /// Returns true if at least the cycle counter could be opened.
+  bool isValid() const { return FDs[Cycles] != -1; }
+
+  /// Returns true if the counter for \p Kind could be opened.
+  bool isValid(EventKind Kind) const { return FDs[Kind] != -1; }
+
+  /// Returns the counts since the counters were opened. The counts of the
+  /// events whose counter could not be opened are zero.
+  Values read() const;
+
+  static StringRef getEventName(EventKind Kind);
+
+private:
+  /// The file descriptor of the counter of each event kind, -1 if it could
+  /// not be opened. The cycle counter leads the group of the others, so that
+  /// they are all read at once.
+  std::array<int, NumEventKinds> FDs;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_PERFEVENTCOUNTERS_H
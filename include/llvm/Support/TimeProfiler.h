@@ -20,8 +20,15 @@ TimeTraceProfiler *getTimeTraceProfilerInstance();
 /// Initialize the time trace profiler.
 /// This sets up the global \p TimeTraceProfilerInstance
 /// variable to be the profiler instance.
+/// If \p MaxEntries is nonzero, the profiler of each thread only keeps the
+/// last \p MaxEntries sections that ended, so that its memory is bounded.
+/// If \p SampleInterval is greater than one, only the first of every
+/// \p SampleInterval outermost sections, and the sections nested in it, are
+/// recorded; the others cost a counter update. The totals by section name
+/// only account for the recorded sections.
 void timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
-                                 StringRef ProcName);
+                                 StringRef ProcName, unsigned MaxEntries = 0,
+                                 unsigned SampleInterval = 1);
 
 /// Cleanup the time trace profiler, if it was initialized.
 void timeTraceProfilerCleanup();
@@ -438,6 +438,13 @@ class MetadataLoader::MetadataLoaderImpl {
   /// populated.
   MDString *lazyLoadOneMDString(unsigned Idx);
 
+  /// Returns the MDString for \p Str, which points into the bitcode buffer.
+  MDString *getMDStringFromBuffer(StringRef Str) {
+    if (Context.doesBitcodeOutliveContext())
+      return MDString::getExternal(Context, Str);
+    return MDString::get(Context, Str);
+  }
+
   /// Index that keeps track of where to find a metadata record in the stream.
   std::vector<uint64_t> GlobalMetadataBitPosIndex;
 
@@ -469,6 +476,10 @@ class MetadataLoader::MetadataLoaderImpl {
   /// True if metadata is being parsed for a module being ThinLTO imported.
   bool IsImporting = false;
 
+  /// True if the module-level metadata block should be loaded on-demand,
+  /// rather than parsed in full, when the metadata is materialized.
+  bool LoadMetadataOnDemand = false;
+
   Error parseOneMetadata(SmallVectorImpl<uint64_t> &Record, unsigned Code,
                          PlaceholderQueue &Placeholders, StringRef Blob,
                          unsigned &NextMetadataNo);
@@ -635,11 +646,12 @@ public:
   MetadataLoaderImpl(BitstreamCursor &Stream, Module &TheModule,
                      BitcodeReaderValueList &ValueList,
                      std::function<Type *(unsigned)> getTypeByID,
-                     bool IsImporting)
+                     bool IsImporting, bool LoadMetadataOnDemand)
       : MetadataList(TheModule.getContext(), Stream.SizeInBytes()),
         ValueList(ValueList), Stream(Stream), Context(TheModule.getContext()),
         TheModule(TheModule), getTypeByID(std::move(getTypeByID)),
-        IsImporting(IsImporting) {}
+        IsImporting(IsImporting),
+        LoadMetadataOnDemand(IsImporting || LoadMetadataOnDemand) {}
 
   Error parseMetadata(bool ModuleLevel);
 
@@ -905,7 +917,7 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
 
   // We lazy-load module-level metadata: we build an index for each record, and
   // then load individual record as needed, starting with the named metadata.
-  if (ModuleLevel && IsImporting && MetadataList.empty() &&
+  if (ModuleLevel && LoadMetadataOnDemand && MetadataList.empty() &&
       !DisableLazyLoading) {
     auto SuccessOrErr = lazyLoadModuleMetadataBlock();
     if (!SuccessOrErr)
@@ -976,7 +988,7 @@ MDString *MetadataLoader::MetadataLoaderImpl::lazyLoadOneMDString(unsigned ID) {
   ++NumMDStringLoaded;
   if (Metadata *MD = MetadataList.lookup(ID))
     return cast<MDString>(MD);
-  auto MDS = MDString::get(Context, MDStringRef[ID]);
+  auto MDS = getMDStringFromBuffer(MDStringRef[ID]);
   MetadataList.assignValue(MDS, ID);
   return MDS;
 }
@@ -1925,7 +1937,7 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
   case bitc::METADATA_STRINGS: {
     auto CreateNextMDString = [&](StringRef Str) {
       ++NumMDStringLoaded;
-      MetadataList.assignValue(MDString::get(Context, Str), NextMetadataNo);
+      MetadataList.assignValue(getMDStringFromBuffer(Str), NextMetadataNo);
       NextMetadataNo++;
     };
     if (Error Err = parseMetadataStrings(Record, Blob, CreateNextMDString))
@@ -2167,10 +2179,11 @@ MetadataLoader::MetadataLoader(MetadataLoader &&RHS)
 MetadataLoader::~MetadataLoader() = default;
 MetadataLoader::MetadataLoader(BitstreamCursor &Stream, Module &TheModule,
                                BitcodeReaderValueList &ValueList,
-                               bool IsImporting,
+                               bool IsImporting, bool LoadMetadataOnDemand,
                                std::function<Type *(unsigned)> getTypeByID)
     : Pimpl(std::make_unique<MetadataLoaderImpl>(
-          Stream, TheModule, ValueList, std::move(getTypeByID), IsImporting)) {}
+          Stream, TheModule, ValueList, std::move(getTypeByID), IsImporting,
+          LoadMetadataOnDemand)) {}
 
 Error MetadataLoader::parseMetadata(bool ModuleLevel) {
   return Pimpl->parseMetadata(ModuleLevel);
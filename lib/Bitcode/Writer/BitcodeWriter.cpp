@@ -67,6 +67,8 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -90,6 +92,11 @@ static cl::opt<bool> WriteRelBFToSummary(
     "write-relbf-to-summary", cl::Hidden, cl::init(false),
     cl::desc("Write relative block frequency to function summary "));
 
+static cl::opt<unsigned> FunctionEncodeThreads(
+    "bitcode-function-encode-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads encoding function blocks when writing a "
+             "module (0 uses all available hardware threads)"));
+
 extern FunctionSummary::ForceSummaryHotnessType ForceSummaryEdgesCold;
 
 namespace {
@@ -202,6 +209,14 @@ public:
               assignValueId(CallEdge.first.getGUID());
   }
 
+  /// Constructs a ModuleBitcodeWriterBase object with a copy of the value
+  /// enumeration of \p Parent, writing to the provided \p Stream.
+  ModuleBitcodeWriterBase(const ModuleBitcodeWriterBase &Parent,
+                          BitstreamWriter &Stream)
+      : BitcodeWriterBase(Stream, Parent.StrtabBuilder), M(Parent.M),
+        VE(Parent.VE), Index(Parent.Index),
+        GlobalValueId(Parent.GlobalValueId) {}
+
 protected:
   void writePerModuleGlobalValueSummary();
 
@@ -274,6 +289,14 @@ public:
   void write();
 
 private:
+  /// Constructs a ModuleBitcodeWriter object that encodes function blocks of
+  /// the module of \p Parent into \p Buffer, see writeFunctionsInParallel().
+  ModuleBitcodeWriter(const ModuleBitcodeWriter &Parent,
+                      SmallVectorImpl<char> &Buffer, BitstreamWriter &Stream)
+      : ModuleBitcodeWriterBase(Parent, Stream), Buffer(Buffer),
+        GenerateHash(false), ModHash(nullptr),
+        BitcodeStartBit(Stream.GetCurrentBitNo()) {}
+
   uint64_t bitcodeStartBit() { return BitcodeStartBit; }
 
   size_t addToStrtab(StringRef Str);
@@ -388,6 +411,10 @@ private:
   void
   writeFunction(const Function &F,
                 DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+  void writeFunctionBody(const Function &F);
+  void writeFunctionsInParallel(
+      unsigned Threads,
+      DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
   void writeBlockInfo();
   void writeModuleHash(size_t BlockStartPos);
 
@@ -3203,6 +3230,12 @@ void ModuleBitcodeWriter::writeFunction(
   FunctionToBitcodeIndex[&F] = Stream.GetCurrentBitNo();
 
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  writeFunctionBody(F);
+  Stream.ExitBlock();
+}
+
+/// Emit the records of a function block, in the block entered by the caller.
+void ModuleBitcodeWriter::writeFunctionBody(const Function &F) {
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -3270,7 +3303,75 @@ void ModuleBitcodeWriter::writeFunction(
   if (VE.shouldPreserveUseListOrder())
     writeUseListBlock(&F);
   VE.purgeFunction();
-  Stream.ExitBlock();
+}
+
+/// Encode the function blocks on \p Threads threads and splice them into the
+/// module stream in order. Each thread writes a contiguous range of functions
+/// to its own buffer, with its own copy of the value enumerator.
+void ModuleBitcodeWriter::writeFunctionsInParallel(
+    unsigned Threads,
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+  std::vector<const Function *> Functions;
+  uint64_t NumInstructions = 0;
+  for (const Function &F : M)
+    if (!F.isDeclaration()) {
+      Functions.push_back(&F);
+      NumInstructions += F.getInstructionCount();
+    }
+
+  struct EncodedRange {
+    SmallVector<char, 0> Buffer;
+    /// The offsets in Buffer of the body of each function block.
+    std::vector<std::pair<size_t, size_t>> Bodies;
+  };
+  ThreadPool Pool(hardware_concurrency(Threads));
+  std::vector<EncodedRange> Ranges(
+      std::min<size_t>(Pool.getThreadCount(), Functions.size()));
+
+  auto EncodeRange = [&](ArrayRef<const Function *> Range,
+                         EncodedRange &Encoded) {
+    BitstreamWriter RangeStream(Encoded.Buffer);
+    ModuleBitcodeWriter Writer(*this, Encoded.Buffer, RangeStream);
+    // Define the abbreviations that the module stream has in scope.
+    Writer.writeBlockInfo();
+    // The stream is 32-bit aligned after entering and exiting a block, so
+    // the bodies are byte ranges of the buffer.
+    for (const Function *F : Range) {
+      RangeStream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+      size_t Begin = RangeStream.GetCurrentBitNo() / 8;
+      Writer.writeFunctionBody(*F);
+      RangeStream.ExitBlock();
+      Encoded.Bodies.emplace_back(Begin, RangeStream.GetCurrentBitNo() / 8);
+    }
+  };
+
+  // Balance the ranges by number of instructions, leaving at least one
+  // function for each of the following ranges.
+  size_t Begin = 0;
+  uint64_t InstructionsSoFar = 0;
+  for (size_t I = 0, E = Ranges.size(); I != E; ++I) {
+    uint64_t Target = NumInstructions * (I + 1) / E;
+    size_t Limit = Functions.size() - (E - I - 1);
+    size_t End = Begin;
+    do
+      InstructionsSoFar += Functions[End++]->getInstructionCount();
+    while (End != Limit && (I + 1 == E || InstructionsSoFar < Target));
+    ArrayRef<const Function *> Range =
+        makeArrayRef(Functions).slice(Begin, End - Begin);
+    Pool.async([&, Range, I] { EncodeRange(Range, Ranges[I]); });
+    Begin = End;
+  }
+  Pool.wait();
+
+  auto NextFunction = Functions.begin();
+  for (const EncodedRange &Encoded : Ranges)
+    for (const auto &Body : Encoded.Bodies) {
+      FunctionToBitcodeIndex[*NextFunction++] = Stream.GetCurrentBitNo();
+      Stream.EmitSubblockWithBody(
+          bitc::FUNCTION_BLOCK_ID, 4,
+          makeArrayRef(Encoded.Buffer).slice(Body.first,
+                                             Body.second - Body.first));
+    }
 }
 
 // Emit blockinfo, which defines the standard abbreviations etc.
@@ -4312,9 +4413,12 @@ void ModuleBitcodeWriter::write() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
-  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
-    if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+  if (FunctionEncodeThreads != 1 && !VE.shouldPreserveUseListOrder())
+    writeFunctionsInParallel(FunctionEncodeThreads, FunctionToBitcodeIndex);
+  else
+    for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
+      if (!F->isDeclaration())
+        writeFunction(*F, FunctionToBitcodeIndex);
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
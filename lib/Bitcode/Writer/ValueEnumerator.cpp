@@ -335,6 +335,22 @@ static bool isIntOrIntVectorValue(const std::pair<const Value*, unsigned> &V) {
   return V.first->getType()->isIntOrIntVectorTy();
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &VE)
+    : TypeMap(VE.TypeMap), Types(VE.Types), ValueMap(VE.ValueMap),
+      Values(VE.Values), Comdats(VE.Comdats), MDs(VE.MDs),
+      FunctionMDs(VE.FunctionMDs), MetadataMap(VE.MetadataMap),
+      FunctionMDInfo(VE.FunctionMDInfo),
+      ShouldPreserveUseListOrder(VE.ShouldPreserveUseListOrder),
+      AttributeGroupMap(VE.AttributeGroupMap),
+      AttributeGroups(VE.AttributeGroups),
+      AttributeListMap(VE.AttributeListMap), AttributeLists(VE.AttributeLists),
+      GlobalBasicBlockIDs(VE.GlobalBasicBlockIDs),
+      NumModuleMDs(VE.NumModuleMDs), NumMDStrings(VE.NumMDStrings) {
+  assert(!ShouldPreserveUseListOrder && "Use-list orders cannot be copied");
+  assert(VE.BasicBlocks.empty() &&
+         "Cannot copy an enumerator with an incorporated function");
+}
+
 ValueEnumerator::ValueEnumerator(const Module &M,
                                  bool ShouldPreserveUseListOrder)
     : ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
@@ -138,7 +138,10 @@ private:
 
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
-  ValueEnumerator(const ValueEnumerator &) = delete;
+  /// Copy the module-level state of \p VE, so that the function blocks of a
+  /// module can be written by several enumerators at once. Use-list orders
+  /// are not copied, so \p VE must not preserve them.
+  ValueEnumerator(const ValueEnumerator &VE);
   ValueEnumerator &operator=(const ValueEnumerator &) = delete;
 
   void dump() const;
@@ -45,6 +45,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -84,6 +85,11 @@ cl::opt<bool> UseSegmentSetForPhysRegs(
 
 } // end namespace llvm
 
+static cl::opt<unsigned> ParallelVirtRegThreshold(
+    "parallel-liveintervals-threshold", cl::Hidden, cl::init(0),
+    cl::desc("Compute the live intervals of functions with more virtual "
+             "registers than this on multiple threads (0 = never)"));
+
 void LiveIntervals::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesCFG();
   AU.addRequired<AAResultsWrapperPass>();
@@ -118,6 +124,7 @@ void LiveIntervals::releaseMemory() {
 
   // Release VNInfo memory regions, VNInfo objects don't need to be dtor'd.
   VNInfoAllocator.Reset();
+  ParallelVNInfoAllocators.clear();
 }
 
 bool LiveIntervals::runOnMachineFunction(MachineFunction &fn) {
@@ -198,6 +205,10 @@ bool LiveIntervals::computeVirtRegInterval(LiveInterval &LI) {
 }
 
 void LiveIntervals::computeVirtRegs() {
+  if (ParallelVirtRegThreshold &&
+      MRI->getNumVirtRegs() > ParallelVirtRegThreshold)
+    return computeVirtRegsInParallel();
+
   for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
     unsigned Reg = Register::index2VirtReg(i);
     if (MRI->reg_nodbg_empty(Reg))
@@ -211,6 +222,48 @@ void LiveIntervals::computeVirtRegs() {
   }
 }
 
+void LiveIntervals::computeVirtRegsInParallel() {
+  SmallVector<LiveInterval *, 0> Intervals;
+  for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
+    unsigned Reg = Register::index2VirtReg(i);
+    if (!MRI->reg_nodbg_empty(Reg))
+      Intervals.push_back(&createEmptyInterval(Reg));
+  }
+  if (Intervals.empty())
+    return;
+
+  // Calculating an interval only reads the function, except for the DFS
+  // numbers the dominator tree computes on demand, so compute them first.
+  DomTree->getBase().updateDFSNumbers();
+
+  // Every task has its own LiveIntervalCalc and VNInfo allocator, and takes
+  // every NumTasks-th interval so that the long ones are spread out.
+  size_t NumTasks = std::min<size_t>(
+      Intervals.size(), parallel::strategy.compute_thread_count() * 4);
+  size_t FirstAlloc = ParallelVNInfoAllocators.size();
+  for (size_t T = 0; T != NumTasks; ++T)
+    ParallelVNInfoAllocators.push_back(std::make_unique<VNInfo::Allocator>());
+  parallelForEachN(0, NumTasks, [&](size_t T) {
+    VNInfo::Allocator &Alloc = *ParallelVNInfoAllocators[FirstAlloc + T];
+    LiveIntervalCalc Calc;
+    for (size_t I = T, E = Intervals.size(); I < E; I += NumTasks) {
+      LiveInterval &LI = *Intervals[I];
+      Calc.reset(MF, Indexes, DomTree, &Alloc);
+      Calc.calculate(LI, MRI->shouldTrackSubRegLiveness(LI.reg));
+    }
+  });
+
+  // Marking dead values changes the instructions, and splitting creates
+  // virtual registers, so finish the intervals in order on this thread.
+  for (LiveInterval *LI : Intervals) {
+    bool NeedSplit = computeDeadValues(*LI, nullptr);
+    if (NeedSplit) {
+      SmallVector<LiveInterval*, 8> SplitLIs;
+      splitSeparateComponents(*LI, SplitLIs);
+    }
+  }
+}
+
 void LiveIntervals::computeRegMasks() {
   RegMaskBlocks.resize(MF->getNumBlockIDs());
 
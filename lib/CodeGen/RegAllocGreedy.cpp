@@ -84,6 +84,8 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumHugeFunctions, "Number of functions allocated without region "
+                            "splitting");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -136,6 +138,13 @@ static cl::opt<bool> ConsiderLocalIntervalCost(
              "candidate when choosing the best split candidate."),
     cl::init(false));
 
+static cl::opt<unsigned> HugeFunctionThreshold(
+    "regalloc-huge-function-threshold", cl::Hidden,
+    cl::desc("Number of virtual registers above which functions are "
+             "allocated without region splitting, whose compile time grows "
+             "faster than the function (0 = never)"),
+    cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -402,6 +411,11 @@ class RAGreedy : public MachineFunctionPass,
   /// by a split candidate when choosing the best split candidate.
   bool EnableAdvancedRASplitCost;
 
+  /// Whether the function is too large for region splitting. Global live
+  /// ranges are then only split around the blocks that use them, which needs
+  /// neither spill placement nor the interference cache.
+  bool IsHugeFunction;
+
   /// Set of broken hints that may be reconciled later because of eviction.
   SmallSetVector<LiveInterval *, 8> SetOfBrokenHints;
 
@@ -2475,8 +2489,8 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   // First try to split around a region spanning multiple blocks. RS_Split2
   // ranges already made dubious progress with region splitting, so they go
-  // straight to single block splitting.
-  if (getStage(VirtReg) < RS_Split2) {
+  // straight to single block splitting, as do all ranges in huge functions.
+  if (getStage(VirtReg) < RS_Split2 && !IsHugeFunction) {
     unsigned PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
     if (PhysReg || !NewVRegs.empty())
       return PhysReg;
@@ -2799,9 +2813,10 @@ unsigned RAGreedy::tryAssignCSRFirstTime(LiveInterval &VirtReg,
     CostPerUseLimit = 1;
     return 0;
   }
-  if (getStage(VirtReg) < RS_Split) {
+  if (getStage(VirtReg) < RS_Split && !IsHugeFunction) {
     // We choose pre-splitting over using the CSR for the first time if
-    // the cost of splitting is lower than CSRCost.
+    // the cost of splitting is lower than CSRCost. Huge functions don't
+    // split around regions, so they use the CSR.
     SA->analyze(&VirtReg);
     unsigned NumCands = 0;
     BlockFrequency BestCost = CSRCost; // Don't modify CSRCost.
@@ -3230,6 +3245,13 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
 
   initializeCSRCost();
 
+  IsHugeFunction = HugeFunctionThreshold &&
+                   MRI->getNumVirtRegs() > HugeFunctionThreshold;
+  if (IsHugeFunction) {
+    LLVM_DEBUG(dbgs() << "Huge function, region splitting is disabled\n");
+    ++NumHugeFunctions;
+  }
+
   calculateSpillWeightsAndHints(*LIS, mf, VRM, *Loops, *MBFI);
 
   LLVM_DEBUG(LIS->dump());
@@ -2345,6 +2345,16 @@ bool DWARFLinker::link() {
     OptContext.CompileUnits.reserve(
         OptContext.File.Dwarf->getNumCompileUnits());
 
+    // Parsing the DIEs dominates reading in the debug info. When running
+    // multi-threaded, parse the compile units of the object concurrently. This
+    // uses the shared llvm::parallel executor rather than a pool of our own,
+    // so that clients linking several files at once stay within one thread
+    // budget. Only the parsing is concurrent: cloning walks the units in
+    // order, since ODR uniquing, abbreviation numbering and the string pool
+    // all depend on that order.
+    if (Options.Threads != 1)
+      OptContext.File.Dwarf->parseAllUnitDIEs();
+
     for (const auto &CU : OptContext.File.Dwarf->compile_units()) {
       updateDwarfVersion(CU->getVersion());
       auto CUDie = CU->getUnitDIE(false);
@@ -43,13 +43,16 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdint>
 #include <deque>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -814,15 +817,115 @@ const DWARFDebugLoc *DWARFContext::getDebugLoc() {
   return Loc.get();
 }
 
-const DWARFDebugAranges *DWARFContext::getDebugAranges() {
+const DWARFDebugAranges *DWARFContext::getDebugAranges(ThreadPool *Pool) {
   if (Aranges)
     return Aranges.get();
 
   Aranges.reset(new DWARFDebugAranges());
-  Aranges->generate(this);
+  if (Pool)
+    withSerializedHandlers([&] { Aranges->generate(this, Pool); });
+  else
+    Aranges->generate(this);
   return Aranges.get();
 }
 
+void DWARFContext::withSerializedHandlers(function_ref<void()> Body) {
+  // The handlers are called through function_refs to the members, so swap
+  // locking wrappers into the members for the duration of Body.
+  std::mutex HandlerMutex;
+  std::function<void(Error)> ErrorHandler = std::move(RecoverableErrorHandler);
+  std::function<void(Error)> Warning = std::move(WarningHandler);
+  RecoverableErrorHandler = [&](Error E) {
+    std::lock_guard<std::mutex> Lock(HandlerMutex);
+    ErrorHandler(std::move(E));
+  };
+  WarningHandler = [&](Error E) {
+    std::lock_guard<std::mutex> Lock(HandlerMutex);
+    Warning(std::move(E));
+  };
+  Body();
+  RecoverableErrorHandler = std::move(ErrorHandler);
+  WarningHandler = std::move(Warning);
+}
+
+/// Get the normal and DWO units of \p Context, ready to be parsed
+/// concurrently.
+static SmallVector<DWARFUnit *, 0> getUnitsToParse(DWARFContext &Context) {
+  // The abbreviation declaration sets are lazily parsed into a cache shared
+  // by all units, so resolve them before parsing the units concurrently.
+  SmallVector<DWARFUnit *, 0> Units;
+  for (const auto &U : Context.normal_units())
+    Units.push_back(U.get());
+  for (const auto &U : Context.dwo_units())
+    Units.push_back(U.get());
+  for (DWARFUnit *U : Units)
+    U->getAbbreviations();
+  return Units;
+}
+
+static void parseUnitDIEs(ArrayRef<DWARFUnit *> Units, ThreadPool &Pool) {
+  for (DWARFUnit *U : Units)
+    Pool.async([U] { U->getNumDIEs(); });
+  Pool.wait();
+}
+
+void DWARFContext::parseAllUnitDIEs(ThreadPool &Pool) {
+  SmallVector<DWARFUnit *, 0> Units = getUnitsToParse(*this);
+  withSerializedHandlers([&] { parseUnitDIEs(Units, Pool); });
+}
+
+void DWARFContext::parseAllUnitDIEs() {
+  SmallVector<DWARFUnit *, 0> Units = getUnitsToParse(*this);
+  withSerializedHandlers([&] {
+    parallelForEach(Units, [](DWARFUnit *U) { U->getNumDIEs(); });
+  });
+}
+
+const DWARFContext::DIENameIndex &
+DWARFContext::getDIENameIndex(ThreadPool *Pool) {
+  if (DIENames)
+    return *DIENames;
+
+  SmallVector<DWARFUnit *, 0> Units = getUnitsToParse(*this);
+
+  // Collect the names of the DIEs of each unit separately, so that the units
+  // can be processed concurrently, and merge them in unit order.
+  std::vector<std::vector<std::pair<StringRef, DWARFDie>>> UnitNames(
+      Units.size());
+  auto CollectNames = [&](size_t I) {
+    DWARFUnit *U = Units[I];
+    for (const DWARFDebugInfoEntry &Entry : U->dies()) {
+      DWARFDie Die(U, &Entry);
+      const char *ShortName = Die.getName(DINameKind::ShortName);
+      if (ShortName)
+        UnitNames[I].emplace_back(ShortName, Die);
+      const char *LinkageName = Die.getName(DINameKind::LinkageName);
+      if (LinkageName && (!ShortName || StringRef(ShortName) != LinkageName))
+        UnitNames[I].emplace_back(LinkageName, Die);
+    }
+  };
+  if (Pool) {
+    // Names may be inherited from DIEs in other units through
+    // DW_AT_specification and DW_AT_abstract_origin, so all units have to be
+    // parsed before any of them is indexed.
+    withSerializedHandlers([&] {
+      parseUnitDIEs(Units, *Pool);
+      for (size_t I = 0, E = Units.size(); I != E; ++I)
+        Pool->async(CollectNames, I);
+      Pool->wait();
+    });
+  } else {
+    for (size_t I = 0, E = Units.size(); I != E; ++I)
+      CollectNames(I);
+  }
+
+  DIENames = std::make_unique<DIENameIndex>();
+  for (const auto &Names : UnitNames)
+    for (const auto &Name : Names)
+      (*DIENames)[Name.first].push_back(Name.second);
+  return *DIENames;
+}
+
 Expected<const DWARFDebugFrame *> DWARFContext::getDebugFrame() {
   if (DebugFrame)
     return DebugFrame.get();
@@ -11,6 +11,7 @@
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugArangeSet.h"
 #include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/ThreadPool.h"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
@@ -42,7 +43,7 @@ void DWARFDebugAranges::extract(
   }
 }
 
-void DWARFDebugAranges::generate(DWARFContext *CTX) {
+void DWARFDebugAranges::generate(DWARFContext *CTX, ThreadPool *Pool) {
   clear();
   if (!CTX)
     return;
@@ -55,16 +56,38 @@ void DWARFDebugAranges::generate(DWARFContext *CTX) {
   // Generate aranges from DIEs: even if .debug_aranges section is present,
   // it may describe only a small subset of compilation units, so we need to
   // manually build aranges for the rest of them.
-  for (const auto &CU : CTX->compile_units()) {
-    uint64_t CUOffset = CU->getOffset();
-    if (ParsedCUOffsets.insert(CUOffset).second) {
-      Expected<DWARFAddressRangesVector> CURanges = CU->collectAddressRanges();
-      if (!CURanges)
-        CTX->getRecoverableErrorHandler()(CURanges.takeError());
-      else
-        for (const auto &R : *CURanges)
-          appendRange(CUOffset, R.LowPC, R.HighPC);
+  SmallVector<DWARFUnit *, 0> CUs;
+  for (const auto &CU : CTX->compile_units())
+    if (ParsedCUOffsets.insert(CU->getOffset()).second)
+      CUs.push_back(CU.get());
+
+  std::vector<Optional<Expected<DWARFAddressRangesVector>>> CURanges(
+      CUs.size());
+  if (Pool) {
+    // The units are independent of each other, except for the abbreviation
+    // declaration sets which are lazily parsed into a cache shared by all of
+    // them, so resolve those before collecting the ranges concurrently.
+    for (DWARFUnit *CU : CUs)
+      CU->getAbbreviations();
+    for (size_t I = 0, E = CUs.size(); I != E; ++I)
+      Pool->async(
+          [&, I] { CURanges[I].emplace(CUs[I]->collectAddressRanges()); });
+    Pool->wait();
+  } else {
+    for (size_t I = 0, E = CUs.size(); I != E; ++I)
+      CURanges[I].emplace(CUs[I]->collectAddressRanges());
+  }
+
+  // Report errors and append the ranges in unit order, which keeps the result
+  // independent of the scheduling of the threads.
+  for (size_t I = 0, E = CUs.size(); I != E; ++I) {
+    Expected<DWARFAddressRangesVector> &Ranges = *CURanges[I];
+    if (!Ranges) {
+      CTX->getRecoverableErrorHandler()(Ranges.takeError());
+      continue;
     }
+    for (const auto &R : *Ranges)
+      appendRange(CUs[I]->getOffset(), R.LowPC, R.HighPC);
   }
 
   construct();
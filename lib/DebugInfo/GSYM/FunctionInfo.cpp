@@ -252,3 +252,112 @@ llvm::Expected<LookupResult> FunctionInfo::lookup(DataExtractor &Data,
     return std::move(Err);
   return LR;
 }
+
+void FunctionInfo::lookup(DataExtractor &Data, const GsymReader &GR,
+                          uint64_t FuncAddr, ArrayRef<uint64_t> Addrs,
+                          LookupResult &LR, LookupCallback Callback) {
+  // Errors are not expected to be common, so when anything goes wrong we
+  // fall back to the single address lookup which reports them accurately.
+  auto LookupOne = [&](size_t I) {
+    auto ExpectedLR = lookup(Data, GR, FuncAddr, Addrs[I]);
+    if (!ExpectedLR)
+      return Callback(I, ExpectedLR.takeError());
+    LR = std::move(*ExpectedLR);
+    Callback(I, LR);
+  };
+  auto LookupAll = [&]() {
+    for (size_t I = 0, E = Addrs.size(); I != E; ++I)
+      LookupOne(I);
+  };
+
+  uint64_t Offset = 0;
+  const uint64_t FuncEnd = FuncAddr + Data.getU32(&Offset);
+  const uint32_t NameOffset = Data.getU32(&Offset);
+  if (!Data.isValidOffset(Offset) || NameOffset == 0)
+    return LookupAll();
+
+  Optional<DataExtractor> LineTableData;
+  Optional<DataExtractor> InlineInfoData;
+  bool Done = false;
+  while (!Done) {
+    if (!Data.isValidOffsetForDataOfSize(Offset, 8))
+      return LookupAll();
+    const uint32_t IT = Data.getU32(&Offset);
+    const uint32_t InfoLength = Data.getU32(&Offset);
+    const StringRef InfoBytes = Data.getData().substr(Offset, InfoLength);
+    if (InfoLength != InfoBytes.size())
+      return LookupAll();
+    DataExtractor InfoData(InfoBytes, Data.isLittleEndian(),
+                           Data.getAddressSize());
+    switch (IT) {
+      case InfoType::EndOfList:
+        Done = true;
+        break;
+      case InfoType::LineTableInfo:
+        LineTableData = InfoData;
+        break;
+      case InfoType::InlineInfo:
+        InlineInfoData = InfoData;
+        break;
+      default:
+        break;
+    }
+    Offset += InfoLength;
+  }
+
+  // Decode the line table once for all of the addresses.
+  SmallVector<LineEntry, 16> LineEntries;
+  if (LineTableData) {
+    LineEntries.resize(Addrs.size());
+    if (llvm::Error Err = LineTable::lookup(*LineTableData, FuncAddr, Addrs,
+                                            LineEntries)) {
+      consumeError(std::move(Err));
+      return LookupAll();
+    }
+  }
+
+  const AddressRange FuncRange(FuncAddr, FuncEnd);
+  const StringRef FuncName = GR.getString(NameOffset);
+  for (size_t I = 0, E = Addrs.size(); I != E; ++I) {
+    const uint64_t Addr = Addrs[I];
+    // Addresses that fall into a gap after the function, or that are not
+    // covered by the line table, are errors.
+    if ((FuncRange.size() > 0 && !FuncRange.contains(Addr)) ||
+        (LineTableData && !LineEntries[I].isValid())) {
+      LookupOne(I);
+      continue;
+    }
+    LR.LookupAddr = Addr;
+    LR.FuncRange = FuncRange;
+    LR.FuncName = FuncName;
+    LR.Locations.clear();
+
+    SourceLocation SrcLoc;
+    SrcLoc.Name = FuncName;
+    SrcLoc.Offset = Addr - FuncAddr;
+    if (!LineTableData) {
+      LR.Locations.push_back(SrcLoc);
+      Callback(I, LR);
+      continue;
+    }
+
+    Optional<FileEntry> LineEntryFile = GR.getFile(LineEntries[I].File);
+    if (!LineEntryFile) {
+      LookupOne(I);
+      continue;
+    }
+    SrcLoc.Dir = GR.getString(LineEntryFile->Dir);
+    SrcLoc.Base = GR.getString(LineEntryFile->Base);
+    SrcLoc.Line = LineEntries[I].Line;
+    LR.Locations.push_back(SrcLoc);
+    if (InlineInfoData) {
+      if (llvm::Error Err = InlineInfo::lookup(GR, *InlineInfoData, FuncAddr,
+                                               Addr, LR.Locations)) {
+        consumeError(std::move(Err));
+        LookupOne(I);
+        continue;
+      }
+    }
+    Callback(I, LR);
+  }
+}
@@ -10,6 +10,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <numeric>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -224,22 +225,22 @@ Optional<uint64_t> GsymReader::getAddressInfoOffset(size_t Index) const {
 }
 
 Expected<uint64_t>
-GsymReader::getAddressIndex(const uint64_t Addr) const {
+GsymReader::getAddressIndex(const uint64_t Addr, size_t StartIndex) const {
   if (Addr >= Hdr->BaseAddress) {
     const uint64_t AddrOffset = Addr - Hdr->BaseAddress;
     Optional<uint64_t> AddrOffsetIndex;
     switch (Hdr->AddrOffSize) {
     case 1:
-      AddrOffsetIndex = getAddressOffsetIndex<uint8_t>(AddrOffset);
+      AddrOffsetIndex = getAddressOffsetIndex<uint8_t>(AddrOffset, StartIndex);
       break;
     case 2:
-      AddrOffsetIndex = getAddressOffsetIndex<uint16_t>(AddrOffset);
+      AddrOffsetIndex = getAddressOffsetIndex<uint16_t>(AddrOffset, StartIndex);
       break;
     case 4:
-      AddrOffsetIndex = getAddressOffsetIndex<uint32_t>(AddrOffset);
+      AddrOffsetIndex = getAddressOffsetIndex<uint32_t>(AddrOffset, StartIndex);
       break;
     case 8:
-      AddrOffsetIndex = getAddressOffsetIndex<uint64_t>(AddrOffset);
+      AddrOffsetIndex = getAddressOffsetIndex<uint64_t>(AddrOffset, StartIndex);
       break;
     default:
       return createStringError(std::errc::invalid_argument,
@@ -291,6 +292,58 @@ llvm::Expected<LookupResult> GsymReader::lookup(uint64_t Addr) const {
                            *AddressIndex);
 }
 
+void GsymReader::lookup(ArrayRef<uint64_t> Addrs,
+                        LookupCallback Callback) const {
+  // Sort the addresses, remembering the index of each of them in Addrs.
+  std::vector<size_t> Order(Addrs.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  llvm::sort(Order, [&](size_t LHS, size_t RHS) {
+    return Addrs[LHS] < Addrs[RHS];
+  });
+  std::vector<uint64_t> SortedAddrs;
+  SortedAddrs.reserve(Addrs.size());
+  for (size_t I : Order)
+    SortedAddrs.push_back(Addrs[I]);
+
+  LookupResult LR;
+  size_t StartIndex = 0;
+  for (size_t I = 0, E = SortedAddrs.size(); I != E;) {
+    // Addresses are sorted, so the search for the next address can start at
+    // the previously found address index.
+    Expected<uint64_t> AddressIndex =
+        getAddressIndex(SortedAddrs[I], StartIndex);
+    if (!AddressIndex) {
+      Callback(Order[I++], AddressIndex.takeError());
+      continue;
+    }
+    StartIndex = *AddressIndex;
+
+    // All following addresses that precede the next entry in the address
+    // table belong to the same FunctionInfo.
+    size_t GroupEnd = I + 1;
+    if (Optional<uint64_t> NextAddr = getAddress(StartIndex + 1)) {
+      while (GroupEnd != E && SortedAddrs[GroupEnd] < *NextAddr)
+        ++GroupEnd;
+    } else {
+      GroupEnd = E;
+    }
+
+    // Address info offsets size should have been checked in parse().
+    assert(StartIndex < AddrInfoOffsets.size());
+    auto AddrInfoOffset = AddrInfoOffsets[StartIndex];
+    DataExtractor Data(MemBuffer->getBuffer().substr(AddrInfoOffset), Endian,
+                       4);
+    const size_t GroupStart = I;
+    FunctionInfo::lookup(
+        Data, *this, *getAddress(StartIndex),
+        makeArrayRef(SortedAddrs).slice(GroupStart, GroupEnd - GroupStart), LR,
+        [&](size_t Index, Expected<const LookupResult &> Result) {
+          Callback(Order[GroupStart + Index], std::move(Result));
+        });
+    I = GroupEnd;
+  }
+}
+
 void GsymReader::dump(raw_ostream &OS) {
   const auto &Header = getHeader();
   // Dump the GSYM header.
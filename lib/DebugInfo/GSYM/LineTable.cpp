@@ -49,7 +49,7 @@ static bool encodeSpecial(int64_t MinLineDelta, int64_t MaxLineDelta,
   return true;
 }
 
-typedef std::function<bool(const LineEntry &Row)> LineEntryCallback;
+typedef function_ref<bool(const LineEntry &Row)> LineEntryCallback;
 
 static llvm::Error parse(DataExtractor &Data, uint64_t BaseAddr,
                          LineEntryCallback const &Callback) {
@@ -286,6 +286,32 @@ Expected<LineEntry> LineTable::lookup(DataExtractor &Data, uint64_t BaseAddr, ui
                            Addr);
 }
 
+llvm::Error LineTable::lookup(DataExtractor &Data, uint64_t BaseAddr,
+                              ArrayRef<uint64_t> Addrs,
+                              MutableArrayRef<LineEntry> Entries) {
+  assert(Addrs.size() == Entries.size() && "one entry per address expected");
+  assert(llvm::is_sorted(Addrs) && "addresses must be sorted");
+  const size_t NumAddrs = Addrs.size();
+  size_t I = 0;
+  LineEntry Prev;
+  llvm::Error Err = parse(Data, BaseAddr, [&](const LineEntry &Row) -> bool {
+    // Addresses before this row belong to the previous row, and addresses
+    // equal to this row's address match it exactly.
+    while (I < NumAddrs && Addrs[I] < Row.Addr)
+      Entries[I++] = Prev;
+    while (I < NumAddrs && Addrs[I] == Row.Addr)
+      Entries[I++] = Row;
+    Prev = Row;
+    return I < NumAddrs; // Stop parsing once all addresses are matched.
+  });
+  if (Err)
+    return Err;
+  // Any remaining addresses are past the last row.
+  while (I < NumAddrs)
+    Entries[I++] = Prev;
+  return Error::success();
+}
+
 raw_ostream &llvm::gsym::operator<<(raw_ostream &OS, const LineTable &LT) {
   for (const auto &LineEntry : LT)
     OS << LineEntry << '\n';
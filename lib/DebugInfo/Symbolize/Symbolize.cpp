@@ -15,6 +15,7 @@
 #include "SymbolizableObjectFile.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/BinaryFormat/COFF.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/PDB/PDB.h"
@@ -38,7 +39,7 @@
 namespace llvm {
 namespace symbolize {
 
-Expected<DILineInfo>
+DILineInfo
 LLVMSymbolizer::symbolizeCodeCommon(SymbolizableModule *Info,
                                     object::SectionedAddress ModuleOffset) {
   // A null module means an error has already been reported. Return an empty
@@ -59,116 +60,239 @@ LLVMSymbolizer::symbolizeCodeCommon(SymbolizableModule *Info,
   return LineInfo;
 }
 
+template <typename T>
+Expected<T>
+LLVMSymbolizer::queryModule(Expected<CachedModule *> ModOrErr,
+                            function_ref<T(SymbolizableModule *)> Query) {
+  if (!ModOrErr)
+    return ModOrErr.takeError();
+  CachedModule *Mod = *ModOrErr;
+  T Result;
+  {
+    std::lock_guard<std::mutex> Lock(Mod->QueryMutex);
+    Result = Query(Mod->Module.get());
+  }
+  releaseModule(Mod);
+  return std::move(Result);
+}
+
 Expected<DILineInfo>
 LLVMSymbolizer::symbolizeCode(const ObjectFile &Obj,
                               object::SectionedAddress ModuleOffset) {
   StringRef ModuleName = Obj.getFileName();
-  auto I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return symbolizeCodeCommon(I->second.get(), ModuleOffset);
-
-  std::unique_ptr<DIContext> Context = DWARFContext::create(Obj);
-  Expected<SymbolizableModule *> InfoOrErr =
-                     createModuleInfo(&Obj, std::move(Context), ModuleName);
-  if (!InfoOrErr)
-    return InfoOrErr.takeError();
-  return symbolizeCodeCommon(*InfoOrErr, ModuleOffset);
+  CachedModule *Mod = lookUpModule(ModuleName);
+  if (!Mod) {
+    std::lock_guard<std::mutex> Lock(LoadMutex);
+    // Another thread may have created the module in the meantime.
+    Mod = lookUpModule(ModuleName);
+    if (!Mod) {
+      std::unique_ptr<DIContext> Context = DWARFContext::create(Obj);
+      Expected<CachedModule *> ModOrErr = createModuleInfo(
+          ObjectPair(&Obj, &Obj), std::move(Context), ModuleName);
+      if (!ModOrErr)
+        return ModOrErr.takeError();
+      Mod = *ModOrErr;
+    }
+  }
+  return queryModule<DILineInfo>(Mod, [&](SymbolizableModule *Info) {
+    return symbolizeCodeCommon(Info, ModuleOffset);
+  });
 }
 
 Expected<DILineInfo>
 LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                               object::SectionedAddress ModuleOffset) {
-  Expected<SymbolizableModule *> InfoOrErr = getOrCreateModuleInfo(ModuleName);
-  if (!InfoOrErr)
-    return InfoOrErr.takeError();
-  return symbolizeCodeCommon(*InfoOrErr, ModuleOffset);
+  return queryModule<DILineInfo>(
+      getOrCreateModuleInfo(ModuleName), [&](SymbolizableModule *Info) {
+        return symbolizeCodeCommon(Info, ModuleOffset);
+      });
 }
 
 Expected<DIInliningInfo>
 LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
                                      object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
-
-  // A null module means an error has already been reported. Return an empty
-  // result.
-  if (!Info)
-    return DIInliningInfo();
-
-  // If the user is giving us relative addresses, add the preferred base of the
-  // object to the offset before we do the query. It's what DIContext expects.
-  if (Opts.RelativeAddresses)
-    ModuleOffset.Address += Info->getModulePreferredBase();
-
-  DIInliningInfo InlinedContext = Info->symbolizeInlinedCode(
-      ModuleOffset, DILineInfoSpecifier(Opts.PathStyle, Opts.PrintFunctions),
-      Opts.UseSymbolTable);
-  if (Opts.Demangle) {
-    for (int i = 0, n = InlinedContext.getNumberOfFrames(); i < n; i++) {
-      auto *Frame = InlinedContext.getMutableFrame(i);
-      Frame->FunctionName = DemangleName(Frame->FunctionName, Info);
-    }
-  }
-  return InlinedContext;
+  return queryModule<DIInliningInfo>(
+      getOrCreateModuleInfo(ModuleName), [&](SymbolizableModule *Info) {
+        // A null module means an error has already been reported. Return an
+        // empty result.
+        if (!Info)
+          return DIInliningInfo();
+
+        // If the user is giving us relative addresses, add the preferred base
+        // of the object to the offset before we do the query. It's what
+        // DIContext expects.
+        if (Opts.RelativeAddresses)
+          ModuleOffset.Address += Info->getModulePreferredBase();
+
+        DIInliningInfo InlinedContext = Info->symbolizeInlinedCode(
+            ModuleOffset,
+            DILineInfoSpecifier(Opts.PathStyle, Opts.PrintFunctions),
+            Opts.UseSymbolTable);
+        if (Opts.Demangle) {
+          for (int i = 0, n = InlinedContext.getNumberOfFrames(); i < n; i++) {
+            auto *Frame = InlinedContext.getMutableFrame(i);
+            Frame->FunctionName = DemangleName(Frame->FunctionName, Info);
+          }
+        }
+        return InlinedContext;
+      });
 }
 
 Expected<DIGlobal>
 LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
                               object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
-
-  // A null module means an error has already been reported. Return an empty
-  // result.
-  if (!Info)
-    return DIGlobal();
-
-  // If the user is giving us relative addresses, add the preferred base of
-  // the object to the offset before we do the query. It's what DIContext
-  // expects.
-  if (Opts.RelativeAddresses)
-    ModuleOffset.Address += Info->getModulePreferredBase();
-
-  DIGlobal Global = Info->symbolizeData(ModuleOffset);
-  if (Opts.Demangle)
-    Global.Name = DemangleName(Global.Name, Info);
-  return Global;
+  return queryModule<DIGlobal>(
+      getOrCreateModuleInfo(ModuleName), [&](SymbolizableModule *Info) {
+        // A null module means an error has already been reported. Return an
+        // empty result.
+        if (!Info)
+          return DIGlobal();
+
+        // If the user is giving us relative addresses, add the preferred base
+        // of the object to the offset before we do the query. It's what
+        // DIContext expects.
+        if (Opts.RelativeAddresses)
+          ModuleOffset.Address += Info->getModulePreferredBase();
+
+        DIGlobal Global = Info->symbolizeData(ModuleOffset);
+        if (Opts.Demangle)
+          Global.Name = DemangleName(Global.Name, Info);
+        return Global;
+      });
 }
 
 Expected<std::vector<DILocal>>
 LLVMSymbolizer::symbolizeFrame(const std::string &ModuleName,
                                object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
-
-  // A null module means an error has already been reported. Return an empty
-  // result.
-  if (!Info)
-    return std::vector<DILocal>();
-
-  // If the user is giving us relative addresses, add the preferred base of
-  // the object to the offset before we do the query. It's what DIContext
-  // expects.
-  if (Opts.RelativeAddresses)
-    ModuleOffset.Address += Info->getModulePreferredBase();
-
-  return Info->symbolizeFrame(ModuleOffset);
+  return queryModule<std::vector<DILocal>>(
+      getOrCreateModuleInfo(ModuleName), [&](SymbolizableModule *Info) {
+        // A null module means an error has already been reported. Return an
+        // empty result.
+        if (!Info)
+          return std::vector<DILocal>();
+
+        // If the user is giving us relative addresses, add the preferred base
+        // of the object to the offset before we do the query. It's what
+        // DIContext expects.
+        if (Opts.RelativeAddresses)
+          ModuleOffset.Address += Info->getModulePreferredBase();
+
+        return Info->symbolizeFrame(ModuleOffset);
+      });
 }
 
 void LLVMSymbolizer::flush() {
+  std::lock_guard<std::mutex> LoadLock(LoadMutex);
+  std::lock_guard<std::mutex> ModulesLock(ModulesMutex);
+  ModulesLRU.clear();
+  Modules.clear();
   ObjectForUBPathAndArch.clear();
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
-  Modules.clear();
+}
+
+LLVMSymbolizer::CachedModule *
+LLVMSymbolizer::lookUpModule(StringRef ModuleName) {
+  std::lock_guard<std::mutex> Lock(ModulesMutex);
+  auto I = Modules.find(ModuleName);
+  if (I == Modules.end())
+    return nullptr;
+  CachedModule *Mod = I->second.get();
+  ModulesLRU.splice(ModulesLRU.begin(), ModulesLRU, Mod->LRUPos);
+  ++Mod->Users;
+  return Mod;
+}
+
+LLVMSymbolizer::CachedModule *
+LLVMSymbolizer::insertModule(StringRef ModuleName,
+                             std::unique_ptr<SymbolizableModule> Module,
+                             ObjectPair Objects, bool MarkInUse) {
+  std::lock_guard<std::mutex> Lock(ModulesMutex);
+  auto InsertResult =
+      Modules.emplace(std::string(ModuleName), std::make_unique<CachedModule>());
+  assert(InsertResult.second);
+  CachedModule *Mod = InsertResult.first->second.get();
+  Mod->Module = std::move(Module);
+  Mod->Objects = Objects;
+  Mod->Name = InsertResult.first->first;
+  Mod->LRUPos = ModulesLRU.insert(ModulesLRU.begin(), Mod);
+  if (MarkInUse)
+    ++Mod->Users;
+
+  if (Opts.MaxCachedModules == 0 || Modules.size() <= Opts.MaxCachedModules)
+    return Mod;
+
+  // Evict the least recently used modules that are not in use. If too many
+  // modules are in use, the cache shrinks on a later insertion.
+  bool Evicted = false;
+  for (auto I = ModulesLRU.end();
+       Modules.size() > Opts.MaxCachedModules && I != ModulesLRU.begin();) {
+    CachedModule *Victim = *--I;
+    if (Victim->Users)
+      continue;
+    I = ModulesLRU.erase(I);
+    Modules.erase(Modules.find(Victim->Name));
+    Evicted = true;
+  }
+  if (Evicted)
+    releaseUnusedObjects();
+  return Mod;
+}
+
+void LLVMSymbolizer::releaseModule(CachedModule *Mod) {
+  std::lock_guard<std::mutex> Lock(ModulesMutex);
+  assert(Mod->Users && "module is not in use");
+  --Mod->Users;
+}
+
+void LLVMSymbolizer::releaseUnusedObjects() {
+  SmallPtrSet<const ObjectFile *, 16> InUse;
+  for (const auto &Entry : Modules) {
+    const ObjectPair &Objects = Entry.second->Objects;
+    if (Objects.first) {
+      InUse.insert(Objects.first);
+      InUse.insert(Objects.second);
+    }
+  }
+
+  for (auto I = ObjectPairForPathArch.begin();
+       I != ObjectPairForPathArch.end();) {
+    // Keep the cached failures, they use no object files.
+    const ObjectPair &Objects = I->second;
+    if (Objects.first &&
+        (!InUse.count(Objects.first) || !InUse.count(Objects.second)))
+      I = ObjectPairForPathArch.erase(I);
+    else
+      ++I;
+  }
+
+  for (auto I = ObjectForUBPathAndArch.begin();
+       I != ObjectForUBPathAndArch.end();) {
+    if (!InUse.count(I->second.get()))
+      I = ObjectForUBPathAndArch.erase(I);
+    else
+      ++I;
+  }
+
+  for (auto I = BinaryForPath.begin(); I != BinaryForPath.end();) {
+    Binary *Bin = I->second.getBinary();
+    bool Used;
+    if (!Bin) {
+      // Keep the cached failures to create a binary.
+      Used = true;
+    } else if (auto *Obj = dyn_cast<ObjectFile>(Bin)) {
+      Used = InUse.count(Obj);
+    } else {
+      // A universal binary is used if any of its object files are.
+      auto UBI = ObjectForUBPathAndArch.lower_bound(
+          std::make_pair(I->first, std::string()));
+      Used = UBI != ObjectForUBPathAndArch.end() && UBI->first.first == I->first;
+    }
+    if (!Used)
+      I = BinaryForPath.erase(I);
+    else
+      ++I;
+  }
 }
 
 namespace {
@@ -503,28 +627,31 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
   return errorCodeToError(object_error::arch_not_found);
 }
 
-Expected<SymbolizableModule *>
-LLVMSymbolizer::createModuleInfo(const ObjectFile *Obj,
+Expected<LLVMSymbolizer::CachedModule *>
+LLVMSymbolizer::createModuleInfo(ObjectPair Objects,
                                  std::unique_ptr<DIContext> Context,
                                  StringRef ModuleName) {
-  auto InfoOrErr = SymbolizableObjectFile::create(Obj, std::move(Context),
-                                                  Opts.UntagAddresses);
-  std::unique_ptr<SymbolizableModule> SymMod;
-  if (InfoOrErr)
-    SymMod = std::move(*InfoOrErr);
-  auto InsertResult = Modules.insert(
-      std::make_pair(std::string(ModuleName), std::move(SymMod)));
-  assert(InsertResult.second);
-  if (!InfoOrErr)
+  auto InfoOrErr = SymbolizableObjectFile::create(
+      Objects.first, std::move(Context), Opts.UntagAddresses);
+  if (!InfoOrErr) {
+    insertModule(ModuleName, nullptr, Objects, /*MarkInUse=*/false);
     return InfoOrErr.takeError();
-  return InsertResult.first->second.get();
+  }
+  return insertModule(ModuleName, std::move(*InfoOrErr), Objects,
+                      /*MarkInUse=*/true);
 }
 
-Expected<SymbolizableModule *>
+Expected<LLVMSymbolizer::CachedModule *>
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  auto I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return I->second.get();
+  if (CachedModule *Mod = lookUpModule(ModuleName))
+    return Mod;
+
+  // Modules are loaded one at a time, which keeps the object file caches
+  // consistent. Queries for modules that are already loaded do not wait.
+  std::lock_guard<std::mutex> Lock(LoadMutex);
+  // Another thread may have loaded the module in the meantime.
+  if (CachedModule *Mod = lookUpModule(ModuleName))
+    return Mod;
 
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
@@ -540,7 +667,8 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
   if (!ObjectsOrErr) {
     // Failed to find valid object file.
-    Modules.emplace(ModuleName, std::unique_ptr<SymbolizableModule>());
+    insertModule(ModuleName, nullptr, ObjectPair(nullptr, nullptr),
+                 /*MarkInUse=*/false);
     return ObjectsOrErr.takeError();
   }
   ObjectPair Objects = ObjectsOrErr.get();
@@ -560,7 +688,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
                                       : PDB_ReaderType::DIA;
       if (auto Err = loadDataForEXE(ReaderType, Objects.first->getFileName(),
                                     Session)) {
-        Modules.emplace(ModuleName, std::unique_ptr<SymbolizableModule>());
+        insertModule(ModuleName, nullptr, Objects, /*MarkInUse=*/false);
         // Return along the PDB filename to provide more context
         return createFileError(PDBFileName, std::move(Err));
       }
@@ -569,7 +697,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   }
   if (!Context)
     Context = DWARFContext::create(*Objects.second, nullptr, Opts.DWPName);
-  return createModuleInfo(Objects.first, std::move(Context), ModuleName);
+  return createModuleInfo(Objects, std::move(Context), ModuleName);
 }
 
 namespace {
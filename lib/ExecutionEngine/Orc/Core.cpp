@@ -947,6 +947,7 @@ Error JITDylib::emit(const SymbolFlagsMap &Emitted) {
       // Update its state and continue.
       if (MII == MaterializingInfos.end()) {
         SymEntry.setState(SymbolState::Ready);
+        addToReadySymbolsCache(SymI);
         continue;
       }
 
@@ -997,6 +998,7 @@ Error JITDylib::emit(const SymbolFlagsMap &Emitted) {
             // Since this dependant is now ready, we erase its MaterializingInfo
             // and update its materializing state.
             DependantSymEntry.setState(SymbolState::Ready);
+            DependantJD.addToReadySymbolsCache(DependantSymI);
             DependantJDReadySymbols.push_back(DependantName);
 
             for (auto &Q : DependantMI.takeQueriesMeeting(SymbolState::Ready)) {
@@ -1014,6 +1016,7 @@ Error JITDylib::emit(const SymbolFlagsMap &Emitted) {
       MI.Dependants.clear();
       if (MI.UnemittedDependencies.empty()) {
         SymI->second.setState(SymbolState::Ready);
+        addToReadySymbolsCache(SymI);
         ThisJDReadySymbols.push_back(Name);
         for (auto &Q : MI.takeQueriesMeeting(SymbolState::Ready)) {
           Q->notifySymbolMetRequiredState(Name, SymI->second.getSymbol());
@@ -1044,6 +1047,28 @@ Error JITDylib::emit(const SymbolFlagsMap &Emitted) {
   return Error::success();
 }
 
+void JITDylib::addToReadySymbolsCache(SymbolTable::iterator SymI) {
+  // Symbols that only carry materialization side effects can not be looked up
+  // by ordinary queries, so leave those to the slow path.
+  if (SymI->second.getFlags().hasMaterializationSideEffectsOnly())
+    return;
+  sys::SmartScopedWriter<true> Lock(ReadySymbolsCacheMutex);
+  ReadySymbolsCache[SymI->first] = SymI->second.getSymbol();
+}
+
+Optional<JITEvaluatedSymbol>
+JITDylib::lookupReadySymbol(const SymbolStringPtr &Name,
+                            JITDylibLookupFlags JDLookupFlags) const {
+  sys::SmartScopedReader<true> Lock(ReadySymbolsCacheMutex);
+  auto I = ReadySymbolsCache.find(Name);
+  if (I == ReadySymbolsCache.end())
+    return None;
+  if (!I->second.getFlags().isExported() &&
+      JDLookupFlags == JITDylibLookupFlags::MatchExportedSymbolsOnly)
+    return None;
+  return I->second;
+}
+
 void JITDylib::notifyFailed(FailedSymbolsWorklist Worklist) {
   AsynchronousSymbolQuerySet FailedQueries;
   auto FailedSymbolsMap = std::make_shared<SymbolDependenceMap>();
@@ -1250,6 +1275,10 @@ Error JITDylib::remove(const SymbolNameSet &Names) {
       }
 
       auto SymI = SymbolMaterializerItrPair.first;
+      if (SymI->second.getState() == SymbolState::Ready) {
+        sys::SmartScopedWriter<true> Lock(ReadySymbolsCacheMutex);
+        ReadySymbolsCache.erase(SymI->first);
+      }
       Symbols.erase(SymI);
     }
 
@@ -1995,6 +2024,12 @@ ExecutionSession::lookup(const JITDylibSearchOrder &SearchOrder,
                          const SymbolLookupSet &Symbols, LookupKind K,
                          SymbolState RequiredState,
                          RegisterDependenciesFunction RegisterDependencies) {
+  // Ready is the final symbol state, so if all symbols are already Ready the
+  // query can be answered without lodging it. Ready symbols never register
+  // dependencies.
+  if (auto Result = lookupReadySymbols(SearchOrder, Symbols))
+    return std::move(*Result);
+
 #if LLVM_ENABLE_THREADS
   // In the threaded case we use promises to return the results.
   std::promise<SymbolMap> PromisedResult;
@@ -2077,6 +2112,28 @@ void ExecutionSession::dump(raw_ostream &OS) {
   });
 }
 
+Optional<SymbolMap>
+ExecutionSession::lookupReadySymbols(const JITDylibSearchOrder &SearchOrder,
+                                     const SymbolLookupSet &Symbols) {
+  if (SearchOrder.empty() || Symbols.empty())
+    return None;
+
+  // Only the first JITDylib in the search order is consulted: if a symbol
+  // is not Ready there we can not tell, without the session lock, whether it
+  // is defined but still materializing (or would be defined by a generator),
+  // in which case the slow path must handle it.
+  auto &JD = *SearchOrder.front().first;
+  auto JDLookupFlags = SearchOrder.front().second;
+  SymbolMap Result;
+  for (auto &KV : Symbols) {
+    auto Sym = JD.lookupReadySymbol(KV.first, JDLookupFlags);
+    if (!Sym)
+      return None;
+    Result[KV.first] = *Sym;
+  }
+  return Result;
+}
+
 void ExecutionSession::runOutstandingMUs() {
   while (1) {
     Optional<std::pair<std::unique_ptr<MaterializationUnit>,
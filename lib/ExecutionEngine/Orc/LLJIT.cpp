@@ -956,6 +956,7 @@ Error LLJITBuilderState::prepareForConstruction() {
            << (CreateCompileFunction ? "Yes" : "No") << "\n"
            << "  Custom platform-setup function: "
            << (SetUpPlatform ? "Yes" : "No") << "\n"
+           << "  Object cache: " << (ObjCache ? "Yes" : "No") << "\n"
            << "  Number of compile threads: " << NumCompileThreads;
     if (!NumCompileThreads)
       dbgs() << " (code will be compiled on the execution thread)\n";
@@ -1050,13 +1051,13 @@ LLJIT::createCompileFunction(LLJITBuilderState &S,
   // Otherwise default to creating a SimpleCompiler, or ConcurrentIRCompiler,
   // depending on the number of threads requested.
   if (S.NumCompileThreads > 0)
-    return std::make_unique<ConcurrentIRCompiler>(std::move(JTMB));
+    return std::make_unique<ConcurrentIRCompiler>(std::move(JTMB), S.ObjCache);
 
   auto TM = JTMB.createTargetMachine();
   if (!TM)
     return TM.takeError();
 
-  return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM));
+  return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM), S.ObjCache);
 }
 
 LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
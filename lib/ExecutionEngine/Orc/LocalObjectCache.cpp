@@ -0,0 +1,153 @@
+//===- LocalObjectCache.cpp - Persistent on-disk cache for ORC ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/LocalObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+namespace llvm {
+namespace orc {
+
+Expected<std::unique_ptr<LocalObjectCache>>
+LocalObjectCache::Create(StringRef CacheDir, StringRef KeyPrefix) {
+  if (std::error_code EC = sys::fs::create_directories(CacheDir))
+    return createFileError(CacheDir, EC);
+  return std::unique_ptr<LocalObjectCache>(
+      new LocalObjectCache(CacheDir, KeyPrefix));
+}
+
+Expected<std::unique_ptr<LocalObjectCache>>
+LocalObjectCache::Create(StringRef CacheDir,
+                         const JITTargetMachineBuilder &JTMB) {
+  return Create(CacheDir, getKeyPrefix(JTMB));
+}
+
+std::string
+LocalObjectCache::getKeyPrefix(const JITTargetMachineBuilder &JTMB) {
+  std::string Prefix;
+  raw_string_ostream OS(Prefix);
+  OS << JTMB.getTargetTriple().str() << ';' << JTMB.getCPU() << ';';
+
+  // Sort the features, their order depends on how they were collected.
+  std::vector<std::string> Features = JTMB.getFeatures().getFeatures();
+  llvm::sort(Features);
+  for (auto &Feature : Features)
+    OS << Feature << ',';
+
+  OS << ';' << static_cast<int>(JTMB.getCodeGenOptLevel()) << ';';
+  if (auto &RM = JTMB.getRelocationModel())
+    OS << static_cast<int>(*RM);
+  OS << ';';
+  if (auto &CM = JTMB.getCodeModel())
+    OS << static_cast<int>(*CM);
+  OS << ';' << JTMB.getOptions().EmulatedTLS;
+  return OS.str();
+}
+
+std::string LocalObjectCache::getKey(const Module &M) const {
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  SHA1 Hasher;
+  Hasher.update(KeyPrefix);
+  Hasher.update(ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(Bitcode.data()), Bitcode.size()));
+  return toHex(Hasher.result());
+}
+
+std::string LocalObjectCache::getEntryPath(StringRef Key) const {
+  // This choice of file name allows the cache to be pruned (see pruneCache()
+  // in include/llvm/Support/CachePruning.h).
+  SmallString<128> EntryPath;
+  sys::path::append(EntryPath, CacheDir, "llvmcache-" + Key);
+  return std::string(EntryPath.str());
+}
+
+bool LocalObjectCache::prune(const CachePruningPolicy &Policy) {
+  return pruneCache(CacheDir, Policy);
+}
+
+std::unique_ptr<MemoryBuffer> LocalObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+  std::string EntryPath = getEntryPath(Key);
+
+  // Update the access time so that entries in use survive pruning.
+  Expected<sys::fs::file_t> FDOrErr =
+      sys::fs::openNativeFileForRead(EntryPath, sys::fs::OF_UpdateAtime);
+  if (FDOrErr) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+        MemoryBuffer::getOpenFile(*FDOrErr, EntryPath,
+                                  /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+    sys::fs::closeFile(*FDOrErr);
+    if (MBOrErr)
+      return std::move(*MBOrErr);
+  } else {
+    consumeError(FDOrErr.takeError());
+  }
+
+  std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void LocalObjectCache::notifyObjectCompiled(const Module *M,
+                                            MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getKey(*M);
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // readers (possibly in other processes) never see a partial entry.
+  SmallString<128> TempFilenameModel;
+  sys::path::append(TempFilenameModel, CacheDir, "Orc-%%%%%%.tmp.o");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+      TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Obj.getBuffer();
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return;
+    }
+  }
+
+  // keep() removes the temporary file itself if it can not be renamed.
+  consumeError(Temp->keep(getEntryPath(Key)));
+}
+
+} // end namespace orc
+} // end namespace llvm
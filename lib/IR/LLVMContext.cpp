@@ -341,6 +341,14 @@ void LLVMContext::setDiscardValueNames(bool Discard) {
   pImpl->DiscardValueNames = Discard;
 }
 
+bool LLVMContext::doesBitcodeOutliveContext() const {
+  return pImpl->BitcodeOutlivesContext;
+}
+
+void LLVMContext::setBitcodeOutlivesContext(bool Outlives) {
+  pImpl->BitcodeOutlivesContext = Outlives;
+}
+
 OptPassGate &LLVMContext::getOptPassGate() const {
   return pImpl->getOptPassGate();
 }
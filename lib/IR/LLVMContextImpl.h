@@ -1272,6 +1272,51 @@ public:
   void getAll(SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const;
 };
 
+/// The uniquing table of MDStrings. The MDStrings are allocated in \c Alloc,
+/// along with a copy of their characters unless those are external (see
+/// MDString::getExternal()). The hash of the characters is kept in the
+/// MDString, so the table never has to look at them when it grows.
+struct MDStringTable {
+  struct KeyTy {
+    StringRef Str;
+    unsigned Hash;
+
+    KeyTy(StringRef Str, unsigned Hash) : Str(Str), Hash(Hash) {}
+  };
+
+  struct Info {
+    static inline MDString *getEmptyKey() {
+      return DenseMapInfo<MDString *>::getEmptyKey();
+    }
+
+    static inline MDString *getTombstoneKey() {
+      return DenseMapInfo<MDString *>::getTombstoneKey();
+    }
+
+    static unsigned getHashValue(const KeyTy &Key) { return Key.Hash; }
+
+    static unsigned getHashValue(const MDString *S) { return S->getHash(); }
+
+    static bool isEqual(const KeyTy &LHS, const MDString *RHS) {
+      if (RHS == getEmptyKey() || RHS == getTombstoneKey())
+        return false;
+      return LHS.Hash == RHS->getHash() && LHS.Str == RHS->getString();
+    }
+
+    static bool isEqual(const MDString *LHS, const MDString *RHS) {
+      return LHS == RHS;
+    }
+  };
+
+  DenseSet<MDString *, Info> Strings;
+  BumpPtrAllocator Alloc;
+
+  void clear() {
+    Strings.clear();
+    Alloc.Reset();
+  }
+};
+
 class LLVMContextImpl {
 public:
   /// OwnedModules - The set of modules instantiated in this context, and which
@@ -1308,7 +1353,7 @@ public:
   FoldingSet<AttributeListImpl> AttrsLists;
   FoldingSet<AttributeSetNode> AttrsSetNodes;
 
-  StringMap<MDString, BumpPtrAllocator> MDStringCache;
+  MDStringTable MDStringCache;
   DenseMap<Value *, ValueAsMetadata *> ValuesAsMetadata;
   DenseMap<Metadata *, MetadataAsValue *> MetadataAsValues;
 
@@ -1439,6 +1484,10 @@ public:
   /// not.
   bool DiscardValueNames = false;
 
+  /// Flag to indicate if the bitcode read into this context outlives it, see
+  /// LLVMContext::setBitcodeOutlivesContext().
+  bool BitcodeOutlivesContext = false;
+
   LLVMContextImpl(LLVMContext &C);
   ~LLVMContextImpl();
 
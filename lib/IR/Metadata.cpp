@@ -450,19 +450,25 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 // MDString implementation.
 //
 
-MDString *MDString::get(LLVMContext &Context, StringRef Str) {
-  auto &Store = Context.pImpl->MDStringCache;
-  auto I = Store.try_emplace(Str);
-  auto &MapEntry = I.first->getValue();
-  if (!I.second)
-    return &MapEntry;
-  MapEntry.Entry = &*I.first;
-  return &MapEntry;
-}
-
-StringRef MDString::getString() const {
-  assert(Entry && "Expected to find string map entry");
-  return Entry->first();
+MDString *MDString::getImpl(LLVMContext &Context, StringRef Str,
+                            bool IsExternal) {
+  unsigned Hash = hash_value(Str);
+  MDStringTable &Table = Context.pImpl->MDStringCache;
+  auto I = Table.Strings.find_as(MDStringTable::KeyTy(Str, Hash));
+  if (I != Table.Strings.end())
+    return *I;
+
+  // Copied strings stay nul-terminated, as they were when the table was a
+  // StringMap.
+  if (!IsExternal) {
+    char *Chars = Table.Alloc.Allocate<char>(Str.size() + 1);
+    std::copy(Str.begin(), Str.end(), Chars);
+    Chars[Str.size()] = '\0';
+    Str = StringRef(Chars, Str.size());
+  }
+  auto *MDS = new (Table.Alloc.Allocate<MDString>()) MDString(Str, Hash);
+  Table.Strings.insert(MDS);
+  return MDS;
 }
 
 //===----------------------------------------------------------------------===//
@@ -18,11 +18,14 @@
 #include "llvm/IR/PassTimingInfo.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/PassInstrumentation.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
@@ -43,6 +46,14 @@ static cl::opt<bool, true> EnableTiming(
     "time-passes", cl::location(TimePassesIsEnabled), cl::Hidden,
     cl::desc("Time each pass, printing elapsed time for each on exit"));
 
+bool TimePassesPerfCountersEnabled = false;
+
+static cl::opt<bool, true> EnablePerfCounters(
+    "time-passes-perf-counters", cl::location(TimePassesPerfCountersEnabled),
+    cl::Hidden,
+    cl::desc("With -time-passes and the new pass manager, also count "
+             "hardware events for each pass and each function"));
+
 namespace {
 namespace legacy {
 
@@ -182,8 +193,14 @@ Timer &TimePassesHandler::getPassTimer(StringRef PassID) {
   return *T;
 }
 
-TimePassesHandler::TimePassesHandler(bool Enabled)
-    : TG("pass", "... Pass execution timing report ..."), Enabled(Enabled) {}
+TimePassesHandler::TimePassesHandler(bool Enabled, bool PerfCounters)
+    : TG("pass", "... Pass execution timing report ..."), Enabled(Enabled) {
+  if (!Enabled || !PerfCounters)
+    return;
+  Counters = std::make_unique<PerfEventCounters>();
+  if (!Counters->isValid())
+    Counters.reset();
+}
 
 void TimePassesHandler::setOutStream(raw_ostream &Out) {
   OutStream = &Out;
@@ -192,7 +209,85 @@ void TimePassesHandler::setOutStream(raw_ostream &Out) {
 void TimePassesHandler::print() {
   if (!Enabled)
     return;
-  TG.print(OutStream ? *OutStream : *CreateInfoOutputFile(), true);
+  std::unique_ptr<raw_ostream> InfoOutputFile;
+  if (!OutStream)
+    InfoOutputFile = CreateInfoOutputFile();
+  raw_ostream &OS = OutStream ? *OutStream : *InfoOutputFile;
+  TG.print(OS, true);
+  printCounts(OS);
+}
+
+/// Prints one table of event counts, sorted by decreasing number of cycles.
+static void printCountsTable(raw_ostream &OS, StringRef Title,
+                             const StringMap<PerfEventCounters::Values> &Counts,
+                             const PerfEventCounters &Counters) {
+  using EntryTy = StringMapEntry<PerfEventCounters::Values>;
+  std::vector<const EntryTy *> Entries;
+  PerfEventCounters::Values Total = {};
+  for (const EntryTy &E : Counts) {
+    Entries.push_back(&E);
+    for (unsigned I = 0; I != PerfEventCounters::NumEventKinds; ++I)
+      Total[I] += E.getValue()[I];
+  }
+  llvm::sort(Entries, [](const EntryTy *L, const EntryTy *R) {
+    if (L->getValue()[PerfEventCounters::Cycles] !=
+        R->getValue()[PerfEventCounters::Cycles])
+      return L->getValue()[PerfEventCounters::Cycles] >
+             R->getValue()[PerfEventCounters::Cycles];
+    return L->getKey() < R->getKey();
+  });
+
+  // Center the title like the timer reports do.
+  OS << "===" << std::string(73, '-') << "===\n";
+  unsigned Padding = (80 - Title.size()) / 2;
+  if (Padding > 80)
+    Padding = 0;
+  OS.indent(Padding) << Title << '\n';
+  OS << "===" << std::string(73, '-') << "===\n";
+
+  auto PrintRow = [&](const PerfEventCounters::Values &V, StringRef Name) {
+    for (unsigned I = 0; I != PerfEventCounters::NumEventKinds; ++I) {
+      auto Kind = static_cast<PerfEventCounters::EventKind>(I);
+      if (!Counters.isValid(Kind))
+        continue;
+      OS << format("%14" PRIu64 "  ", V[I]);
+      if (Kind == PerfEventCounters::Instructions)
+        OS << format("%5.2f  ", V[PerfEventCounters::Cycles]
+                                    ? double(V[I]) / V[PerfEventCounters::Cycles]
+                                    : 0.0);
+    }
+    OS << Name << '\n';
+  };
+
+  for (unsigned I = 0; I != PerfEventCounters::NumEventKinds; ++I) {
+    auto Kind = static_cast<PerfEventCounters::EventKind>(I);
+    if (!Counters.isValid(Kind))
+      continue;
+    OS << format("%14s  ", PerfEventCounters::getEventName(Kind).str().c_str());
+    if (Kind == PerfEventCounters::Instructions)
+      OS << "  IPC  ";
+  }
+  OS << "Name\n";
+  for (const EntryTy *E : Entries)
+    PrintRow(E->getValue(), E->getKey());
+  PrintRow(Total, "Total");
+  OS << '\n';
+}
+
+void TimePassesHandler::printCounts(raw_ostream &OS) {
+  if (!Counters)
+    return;
+  if (!PassCounts.empty())
+    printCountsTable(OS, "... Pass execution hardware event counts ...",
+                     PassCounts, *Counters);
+  if (!FunctionCounts.empty())
+    printCountsTable(OS, "... Function hardware event counts ...",
+                     FunctionCounts, *Counters);
+  OS.flush();
+
+  // Reset the counts like the timers are reset.
+  PassCounts.clear();
+  FunctionCounts.clear();
 }
 
 LLVM_DUMP_METHOD void TimePassesHandler::dump() const {
@@ -234,6 +329,44 @@ void TimePassesHandler::stopTimer(StringRef PassID) {
     MyTimer->stopTimer();
 }
 
+void TimePassesHandler::startCounters(Any IR) {
+  if (!Counters)
+    return;
+  // Only passes that run on a function are attributed to it. Loop passes are
+  // not, as the IR library can not look into loops.
+  std::string FunctionName;
+  if (any_isa<const Function *>(IR))
+    FunctionName = any_cast<const Function *>(IR)->getName().str();
+  CountsStack.emplace_back(Counters->read(), std::move(FunctionName));
+}
+
+void TimePassesHandler::stopCounters(StringRef PassID) {
+  if (!Counters)
+    return;
+  assert(!CountsStack.empty() && "empty stack in stopCounters");
+  EventCounts End = Counters->read();
+  auto Start = CountsStack.pop_back_val();
+  EventCounts Delta;
+  for (unsigned I = 0; I != PerfEventCounters::NumEventKinds; ++I)
+    Delta[I] = End[I] - Start.first[I];
+
+  EventCounts &PassTotal = PassCounts[PassID];
+  for (unsigned I = 0; I != PerfEventCounters::NumEventKinds; ++I)
+    PassTotal[I] += Delta[I];
+
+  // Like the time of nested timers, the events of an analysis run from within
+  // a pass are also counted for the pass. Only count them once for the
+  // function though, when the outermost pass on it finishes.
+  if (Start.second.empty() ||
+      llvm::any_of(CountsStack, [&](const auto &Outer) {
+        return Outer.second == Start.second;
+      }))
+    return;
+  EventCounts &FunctionTotal = FunctionCounts[Start.second];
+  for (unsigned I = 0; I != PerfEventCounters::NumEventKinds; ++I)
+    FunctionTotal[I] += Delta[I];
+}
+
 static bool matchPassManager(StringRef PassID) {
   size_t prefix_pos = PassID.find('<');
   if (prefix_pos == StringRef::npos)
@@ -243,11 +376,12 @@ static bool matchPassManager(StringRef PassID) {
          Prefix.endswith("AnalysisManagerProxy");
 }
 
-bool TimePassesHandler::runBeforePass(StringRef PassID) {
+bool TimePassesHandler::runBeforePass(StringRef PassID, Any IR) {
   if (matchPassManager(PassID))
     return true;
 
   startTimer(PassID);
+  startCounters(IR);
 
   LLVM_DEBUG(dbgs() << "after runBeforePass(" << PassID << ")\n");
   LLVM_DEBUG(dump());
@@ -260,6 +394,7 @@ void TimePassesHandler::runAfterPass(StringRef PassID) {
   if (matchPassManager(PassID))
     return;
 
+  stopCounters(PassID);
   stopTimer(PassID);
 
   LLVM_DEBUG(dbgs() << "after runAfterPass(" << PassID << ")\n");
@@ -271,13 +406,13 @@ void TimePassesHandler::registerCallbacks(PassInstrumentationCallbacks &PIC) {
     return;
 
   PIC.registerBeforePassCallback(
-      [this](StringRef P, Any) { return this->runBeforePass(P); });
+      [this](StringRef P, Any IR) { return this->runBeforePass(P, IR); });
   PIC.registerAfterPassCallback(
       [this](StringRef P, Any) { this->runAfterPass(P); });
   PIC.registerAfterPassInvalidatedCallback(
       [this](StringRef P) { this->runAfterPass(P); });
   PIC.registerBeforeAnalysisCallback(
-      [this](StringRef P, Any) { this->runBeforePass(P); });
+      [this](StringRef P, Any IR) { this->runBeforePass(P, IR); });
   PIC.registerAfterAnalysisCallback(
       [this](StringRef P, Any) { this->runAfterPass(P); });
 }
@@ -48,4 +48,84 @@ void Use::zap(Use *Start, const Use *Stop, bool del) {
     ::operator delete(Start);
 }
 
+#if LLVM_ENABLE_COMPACT_USES
+const Use *Use::getImpliedUser() const {
+  const Use *Current = this;
+
+  while (true) {
+    unsigned Tag = (Current++)->Prev.getInt();
+    switch (Tag) {
+    case zeroDigitTag:
+    case oneDigitTag:
+      continue;
+
+    case stopTag: {
+      // The digit following a stop tag is the leading one of the offset.
+      ++Current;
+      ptrdiff_t Offset = 1;
+      while (true) {
+        unsigned Tag = Current->Prev.getInt();
+        switch (Tag) {
+        case zeroDigitTag:
+        case oneDigitTag:
+          ++Current;
+          Offset = (Offset << 1) + Tag;
+          continue;
+        default:
+          return Current + Offset;
+        }
+      }
+    }
+
+    case fullStopTag:
+      return Current;
+    }
+  }
+}
+
+Use *Use::initTags(Use *const Start, Use *Stop) {
+  // The tags of the last 20 Uses are precomputed, so that the Uses of most
+  // Users find their end quickly.
+  ptrdiff_t Done = 0;
+  while (Done < 20) {
+    if (Start == Stop--)
+      return Start;
+    static const PrevPtrTag tags[20] = {
+        fullStopTag,  oneDigitTag,  stopTag,      oneDigitTag, oneDigitTag,
+        stopTag,      zeroDigitTag, oneDigitTag,  oneDigitTag, stopTag,
+        zeroDigitTag, oneDigitTag,  zeroDigitTag, oneDigitTag, stopTag,
+        oneDigitTag,  oneDigitTag,  oneDigitTag,  oneDigitTag, stopTag};
+    new (Stop) Use(tags[Done++]);
+  }
+
+  // Further away from the end, spell out the distance to the next stop tag,
+  // most significant digit first, before each stop tag.
+  ptrdiff_t Count = Done;
+  while (Start != Stop) {
+    --Stop;
+    if (!Count) {
+      new (Stop) Use(stopTag);
+      ++Done;
+      Count = Done;
+    } else {
+      new (Stop) Use(PrevPtrTag(Count & 1));
+      Count >>= 1;
+      ++Done;
+    }
+  }
+
+  return Start;
+}
+
+User *Use::getUser() const {
+  // The end of the Uses of a User with co-allocated operands is the User
+  // itself, which starts with an aligned Type pointer, so its bottom bit is
+  // clear. Hung off uses are followed by a UserRef with the bottom bit set.
+  const Use *End = getImpliedUser();
+  const UserRef *Ref = reinterpret_cast<const UserRef *>(End);
+  return Ref->getInt() ? Ref->getPointer()
+                       : reinterpret_cast<User *>(const_cast<Use *>(End));
+}
+#endif
+
 } // namespace llvm
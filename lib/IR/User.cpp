@@ -43,6 +43,22 @@ void User::allocHungoffUses(unsigned N, bool IsPhi) {
   static_assert(alignof(Use) >= alignof(BasicBlock *),
                 "Alignment is insufficient for 'hung-off-uses' pieces");
 
+#if LLVM_ENABLE_COMPACT_USES
+  static_assert(alignof(Use) >= alignof(Use::UserRef),
+                "Alignment is insufficient for 'hung-off-uses' pieces");
+  static_assert(alignof(Use::UserRef) >= alignof(BasicBlock *),
+                "Alignment is insufficient for 'hung-off-uses' pieces");
+
+  // Allocate the array of Uses, followed by a pointer (with bottom bit set) to
+  // the User.
+  size_t size = N * sizeof(Use) + sizeof(Use::UserRef);
+  if (IsPhi)
+    size += N * sizeof(BasicBlock *);
+  Use *Begin = static_cast<Use*>(::operator new(size));
+  Use *End = Begin + N;
+  (void) new (End) Use::UserRef(const_cast<User *>(this), 1);
+  setOperandList(Use::initTags(Begin, End));
+#else
   // Allocate the array of Uses
   size_t size = N * sizeof(Use);
   if (IsPhi)
@@ -52,6 +68,7 @@ void User::allocHungoffUses(unsigned N, bool IsPhi) {
   setOperandList(Begin);
   for (; Begin != End; Begin++)
     new (Begin) Use(this);
+#endif
 }
 
 void User::growHungoffUses(unsigned NewNumUses, bool IsPhi) {
@@ -72,8 +89,8 @@ void User::growHungoffUses(unsigned NewNumUses, bool IsPhi) {
 
   // If this is a Phi, then we need to copy the BB pointers too.
   if (IsPhi) {
-    auto *OldPtr = reinterpret_cast<char *>(OldOps + OldNumUses);
-    auto *NewPtr = reinterpret_cast<char *>(NewOps + NewNumUses);
+    auto *OldPtr = static_cast<char *>(getHungoffPhiBlocks(OldOps, OldNumUses));
+    auto *NewPtr = static_cast<char *>(getHungoffPhiBlocks(NewOps, NewNumUses));
     std::copy(OldPtr, OldPtr + (OldNumUses * sizeof(BasicBlock *)), NewPtr);
   }
   Use::zap(OldOps, OldOps + OldNumUses, true);
@@ -131,8 +148,12 @@ void *User::allocateFixedOperandUser(size_t Size, unsigned Us,
   Obj->NumUserOperands = Us;
   Obj->HasHungOffUses = false;
   Obj->HasDescriptor = DescBytes != 0;
+#if LLVM_ENABLE_COMPACT_USES
+  Use::initTags(Start, End);
+#else
   for (; Start != End; Start++)
     new (Start) Use(Obj);
+#endif
 
   if (DescBytes != 0) {
     auto *DescInfo = reinterpret_cast<DescriptorInfo *>(Storage + DescBytes);
@@ -79,11 +79,13 @@ void llvm::computeLTOCacheKey(
     const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
     const GVSummaryMapTy &DefinedGlobals,
     const std::set<GlobalValue::GUID> &CfiFunctionDefs,
-    const std::set<GlobalValue::GUID> &CfiFunctionDecls) {
+    const std::set<GlobalValue::GUID> &CfiFunctionDecls,
+    const ModuleHash *ImportsHash) {
   // Compute the unique hash for this entry.
   // This is based on the current compiler version, the module itself, the
-  // export list, the hash for every single module in the import list, the
-  // list of ResolvedODR for the module, and the list of preserved symbols.
+  // export list, the hash for every single module in the import list (or of
+  // the imported content), the list of ResolvedODR for the module, and the
+  // list of preserved symbols.
   SHA1 Hasher;
 
   // Start with the compiler revision
@@ -155,9 +157,14 @@ void llvm::computeLTOCacheKey(
     Hasher.update(ArrayRef<uint8_t>((uint8_t *)&GUID, sizeof(GUID)));
   }
 
-  // Include the hash for every module we import functions from. The set of
-  // imported symbols for each module may affect code generation and is
-  // sensitive to link order, so include that as well.
+  // Include the hash for every module we import functions from, unless we
+  // were given a hash of the imported content. The set of imported symbols
+  // for each module may affect code generation and is sensitive to link
+  // order, so include that as well.
+  if (ImportsHash)
+    Hasher.update(
+        ArrayRef<uint8_t>((const uint8_t *)&(*ImportsHash)[0],
+                          sizeof(*ImportsHash)));
   using ImportMapIteratorTy = FunctionImporter::ImportMapTy::const_iterator;
   std::vector<ImportMapIteratorTy> ImportModulesVector;
   ImportModulesVector.reserve(ImportList.size());
@@ -170,8 +177,13 @@ void llvm::computeLTOCacheKey(
              [](const ImportMapIteratorTy &Lhs, const ImportMapIteratorTy &Rhs)
                  -> bool { return Lhs->getKey() < Rhs->getKey(); });
   for (const ImportMapIteratorTy &EntryIt : ImportModulesVector) {
-    auto ModHash = Index.getModuleHash(EntryIt->first());
-    Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+    if (!ImportsHash) {
+      auto ModHash = Index.getModuleHash(EntryIt->first());
+      Hasher.update(
+          ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+    } else {
+      AddString(EntryIt->first());
+    }
 
     AddUint64(EntryIt->second.size());
     for (auto &Fn : EntryIt->second)
@@ -681,7 +693,8 @@ LTO::addRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
   RegularLTOState::AddedModule Mod;
   Expected<std::unique_ptr<Module>> MOrErr =
       BM.getLazyModule(RegularLTO.Ctx, /*ShouldLazyLoadMetadata*/ true,
-                       /*IsImporting*/ false);
+                       /*IsImporting*/ false,
+                       /*LoadMetadataOnDemand*/ Conf.RegularLTOLazyMetadata);
   if (!MOrErr)
     return MOrErr.takeError();
   Module &M = **MOrErr;
@@ -1164,11 +1177,21 @@ public:
       // no module hash.
       return RunThinBackend(AddStream);
 
+    Optional<ModuleHash> ImportsHash;
+    if (Conf.ThinLTOCacheImportedContent && !ImportList.empty()) {
+      Expected<ModuleHash> HashOrErr = computeImportsHash(
+          Conf, BM, CombinedIndex, ImportList, ModuleMap);
+      if (!HashOrErr)
+        return HashOrErr.takeError();
+      ImportsHash = *HashOrErr;
+    }
+
     SmallString<40> Key;
     // The module may be cached, this helps handling it.
     computeLTOCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList,
                        ExportList, ResolvedODR, DefinedGlobals, CfiFunctionDefs,
-                       CfiFunctionDecls);
+                       CfiFunctionDecls,
+                       ImportsHash ? ImportsHash.getPointer() : nullptr);
     if (AddStreamFn CacheAddStream = Cache(Task, Key))
       return RunThinBackend(CacheAddStream);
 
@@ -1195,7 +1218,9 @@ public:
             MapVector<StringRef, BitcodeModule> &ModuleMap) {
           if (LLVM_ENABLE_THREADS && Conf.TimeTraceEnabled)
             timeTraceProfilerInitialize(Conf.TimeTraceGranularity,
-                                        "thin backend");
+                                        "thin backend",
+                                        Conf.TimeTraceMaxEntries,
+                                        Conf.TimeTraceSampleInterval);
           Error E = runThinLTOBackendThread(
               AddStream, Cache, Task, BM, CombinedIndex, ImportList, ExportList,
               ResolvedODR, DefinedGlobals, ModuleMap);
@@ -31,11 +31,13 @@
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Passes/StandardInstrumentations.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/SmallVectorMemoryBuffer.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
@@ -528,6 +530,54 @@ static void dropDeadSymbols(Module &Mod, const GVSummaryMapTy &DefinedGlobals,
   }
 }
 
+Expected<ModuleHash>
+lto::computeImportsHash(const Config &Conf, BitcodeModule &BM,
+                        const ModuleSummaryIndex &CombinedIndex,
+                        const FunctionImporter::ImportMapTy &ImportList,
+                        MapVector<StringRef, BitcodeModule> &ModuleMap) {
+  LTOLLVMContext Ctx(Conf);
+
+  // Give the destination module the triple and data layout of the importing
+  // module, so that the import sees the same target as in thinBackend().
+  Expected<std::unique_ptr<Module>> MOrErr =
+      BM.getLazyModule(Ctx, /*ShouldLazyLoadMetadata=*/true,
+                       /*IsImporting*/ false);
+  if (!MOrErr)
+    return MOrErr.takeError();
+  Module Dest("imports", Ctx);
+  Dest.setTargetTriple((*MOrErr)->getTargetTriple());
+  Dest.setDataLayout((*MOrErr)->getDataLayout());
+
+  auto ModuleLoader = [&](StringRef Identifier) {
+    auto I = ModuleMap.find(Identifier);
+    assert(I != ModuleMap.end());
+    return I->second.getLazyModule(Ctx, /*ShouldLazyLoadMetadata=*/true,
+                                   /*IsImporting*/ true);
+  };
+
+  // Whether dso_local is dropped from the imported declarations is determined
+  // by the configuration and the importing module, which are both part of the
+  // cache key, so the imported content is hashed without that step.
+  FunctionImporter Importer(CombinedIndex, ModuleLoader,
+                            /*ClearDSOLocalOnDeclarations=*/false);
+  if (Error Err = Importer.importFunctions(Dest, ImportList).takeError())
+    return std::move(Err);
+
+  // The textual IR is independent of the order and numbering of anything in
+  // the source modules that was not imported.
+  SmallString<0> IR;
+  raw_svector_ostream OS(IR);
+  Dest.print(OS, /*AAW=*/nullptr);
+
+  SHA1 Hasher;
+  Hasher.update(IR);
+  StringRef Result = Hasher.result();
+  ModuleHash Hash;
+  for (int Pos = 0; Pos < 20; Pos += 4)
+    Hash[Pos / 4] = support::endian::read32be(Result.data() + Pos);
+  return Hash;
+}
+
 Error lto::thinBackend(const Config &Conf, unsigned Task, AddStreamFn AddStream,
                        Module &Mod, const ModuleSummaryIndex &CombinedIndex,
                        const FunctionImporter::ImportMapTy &ImportList,
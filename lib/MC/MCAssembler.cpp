@@ -8,6 +8,10 @@
 
 #include "llvm/MC/MCAssembler.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -68,6 +72,7 @@ STATISTIC(evaluateFixup, "Number of evaluated fixups");
 STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
+STATISTIC(RelaxationVisits, "Number of fragments visited for relaxation");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
 
 } // end namespace stats
@@ -764,6 +769,348 @@ MCAssembler::handleFixup(const MCAsmLayout &Layout, MCFragment &F,
   return std::make_tuple(Target, FixedValue, IsResolved);
 }
 
+/// Decides which fragments have to be visited again during relaxation.
+///
+/// Whether a fragment has to be relaxed, and what it's relaxed to, only
+/// depends on the layout of a few fragments, its points: usually itself and
+/// the fragments that the symbols in its expressions are defined in. These
+/// are recorded up front. Most fragments only depend on the distances between
+/// their points in the same section, which only change when a fragment
+/// between them changes size. Boundary align and org fragments depend on
+/// where their points are in the section, which changes when any fragment
+/// before them changes size.
+///
+/// Fragments only change size when they are relaxed, except for those whose
+/// size is computed during layout. Fill and org fragments are checked when
+/// they are visited. An align fragment, whose size depends on where it is, is
+/// assumed to have changed size whenever a fragment before it did. This is
+/// decided without laying out the section again, so the layout is only
+/// recomputed up to the fragments that are actually visited. Fragments with
+/// expressions or fixups that can't be looked into, such as target specific
+/// ones, are visited again whenever any fragment changes size.
+class MCAssembler::RelaxationWorklist {
+  /// Fragments whose distance to each other matters to User are in [Lo, Hi)
+  /// by layout order.
+  struct Interval {
+    unsigned Lo;
+    unsigned Hi;
+    MCFragment *User;
+  };
+
+  struct SectionState {
+    std::vector<MCFragment *> Fragments;
+    /// The intervals spanning at most MaxShortSpan fragments starting at
+    /// fragment I are ShortIntervals[ShortBegin[I]] up to
+    /// ShortIntervals[ShortBegin[I + 1]].
+    std::vector<unsigned> ShortBegin;
+    std::vector<Interval> ShortIntervals;
+    /// The other intervals.
+    std::vector<Interval> LongIntervals;
+    /// Fragments that depend on where the fragments before Hi are, sorted by
+    /// Hi.
+    std::vector<std::pair<unsigned, MCFragment *>> AbsoluteUsers;
+    /// The align fragments that are in an interval.
+    std::vector<unsigned> Aligns;
+    /// The fragments to visit, by layout order.
+    BitVector Pending;
+  };
+
+  /// How many fragments an interval may span to be looked up by where it
+  /// starts.
+  static constexpr unsigned MaxShortSpan = 64;
+
+  MCAssembler &Asm;
+  MCAsmLayout &Layout;
+
+  /// The state of every section, by layout order.
+  std::vector<SectionState> Sections;
+
+  /// The fragments to visit whenever any fragment changes size.
+  std::vector<MCFragment *> AlwaysVisit;
+
+  /// The size fill and org fragments had when they were last visited.
+  DenseMap<const MCFragment *, uint64_t> ComputedSizes;
+
+  /// Adds the fragments the symbols in \p Expr are defined in to \p Points.
+  /// Returns false if \p Expr can't be looked into.
+  static bool addPoints(const MCExpr &Expr,
+                        SmallPtrSetImpl<const MCSymbol *> &Visited,
+                        SmallVectorImpl<const MCFragment *> &Points);
+
+  /// Records what \p F depends on. Returns false if \p F never needs to be
+  /// visited.
+  bool addUser(MCFragment &F);
+
+public:
+  RelaxationWorklist(MCAssembler &Asm, MCAsmLayout &Layout);
+
+  /// Returns the first fragment of \p Sec after \p Prev that is pending, or
+  /// the first pending fragment if \p Prev is null, and removes it from the
+  /// worklist. Returns null if there is none.
+  MCFragment *takePending(MCSection &Sec, const MCFragment *Prev) {
+    SectionState &S = Sections[Sec.getLayoutOrder()];
+    int Next = Prev ? S.Pending.find_next(Prev->getLayoutOrder())
+                    : S.Pending.find_first();
+    if (Next < 0)
+      return nullptr;
+    S.Pending.reset(Next);
+    return S.Fragments[Next];
+  }
+
+  bool hasPending(const MCSection &Sec) const {
+    return Sections[Sec.getLayoutOrder()].Pending.any();
+  }
+
+  bool hasPending() const {
+    return llvm::any_of(Sections,
+                        [](const SectionState &S) { return S.Pending.any(); });
+  }
+
+  /// For fragments whose size is computed during layout, returns whether
+  /// \p F has a different size than when it was last visited.
+  bool updateComputedSize(const MCFragment &F);
+
+  /// Visits \p F again in the next step.
+  void enqueue(MCFragment &F) {
+    Sections[F.getParent()->getLayoutOrder()].Pending.set(F.getLayoutOrder());
+  }
+
+  /// Queues the fragments that depend on the size of the fragments of \p Sec
+  /// at \p Changed, in layout order.
+  void update(MCSection &Sec, ArrayRef<unsigned> Changed);
+};
+
+MCAssembler::RelaxationWorklist::RelaxationWorklist(MCAssembler &Asm,
+                                                   MCAsmLayout &Layout)
+    : Asm(Asm), Layout(Layout) {
+  Sections.resize(Layout.getSectionOrder().size());
+  for (MCSection *Sec : Layout.getSectionOrder()) {
+    SectionState &S = Sections[Sec->getLayoutOrder()];
+    for (MCFragment &F : *Sec)
+      S.Fragments.push_back(&F);
+    S.ShortBegin.assign(S.Fragments.size() + 1, 0);
+    S.Pending.resize(S.Fragments.size());
+  }
+
+  // Everything moves from its unknown initial position, so the first step
+  // visits every fragment that can be relaxed.
+  for (MCSection *Sec : Layout.getSectionOrder())
+    for (MCFragment &F : *Sec)
+      if (addUser(F))
+        enqueue(F);
+
+  for (SectionState &S : Sections) {
+    // Index the short intervals by where they start.
+    for (unsigned I = 1, E = S.ShortBegin.size(); I != E; ++I)
+      S.ShortBegin[I] += S.ShortBegin[I - 1];
+    std::vector<Interval> Short(S.ShortIntervals.size());
+    for (const Interval &I : S.ShortIntervals)
+      Short[--S.ShortBegin[I.Lo + 1]] = I;
+    S.ShortIntervals = std::move(Short);
+    for (unsigned I = 0, E = S.Fragments.size(); I != E; ++I)
+      S.ShortBegin[I] = S.ShortBegin[I + 1];
+    S.ShortBegin.back() = S.ShortIntervals.size();
+
+    llvm::sort(S.AbsoluteUsers, llvm::less_first());
+
+    // Only the align fragments inside an interval matter.
+    std::vector<int> Depth(S.Fragments.size() + 1);
+    for (const Interval &I : S.ShortIntervals) {
+      ++Depth[I.Lo];
+      --Depth[I.Hi];
+    }
+    for (const Interval &I : S.LongIntervals) {
+      ++Depth[I.Lo];
+      --Depth[I.Hi];
+    }
+    int Open = 0;
+    for (unsigned I = 0, E = S.Fragments.size(); I != E; ++I) {
+      Open += Depth[I];
+      if (Open && isa<MCAlignFragment>(S.Fragments[I]))
+        S.Aligns.push_back(I);
+    }
+  }
+}
+
+bool MCAssembler::RelaxationWorklist::addPoints(
+    const MCExpr &Expr, SmallPtrSetImpl<const MCSymbol *> &Visited,
+    SmallVectorImpl<const MCFragment *> &Points) {
+  switch (Expr.getKind()) {
+  case MCExpr::Target:
+    return false;
+  case MCExpr::Constant:
+    return true;
+  case MCExpr::Unary:
+    return addPoints(*cast<MCUnaryExpr>(Expr).getSubExpr(), Visited, Points);
+  case MCExpr::Binary: {
+    const MCBinaryExpr &BE = cast<MCBinaryExpr>(Expr);
+    return addPoints(*BE.getLHS(), Visited, Points) &&
+           addPoints(*BE.getRHS(), Visited, Points);
+  }
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(Expr).getSymbol();
+    if (!Visited.insert(&Sym).second)
+      return true;
+    if (Sym.isVariable())
+      return addPoints(*Sym.getVariableValue(/*SetUsed=*/false), Visited,
+                       Points);
+    if (Sym.isInSection())
+      Points.push_back(Sym.getFragment());
+    return true;
+  }
+  }
+  llvm_unreachable("Invalid assembly expression kind!");
+}
+
+bool MCAssembler::RelaxationWorklist::addUser(MCFragment &F) {
+  SmallPtrSet<const MCSymbol *, 4> Visited;
+  SmallVector<const MCFragment *, 4> Points;
+  bool Absolute = false;
+  bool Known = true;
+  switch (F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    // Fixups are resolved relative to where they are.
+    Points.push_back(&F);
+    for (const MCFixup &Fixup : cast<MCRelaxableFragment>(F).getFixups()) {
+      if (Asm.getBackend().getFixupKindInfo(Fixup.getKind()).Flags &
+          MCFixupKindInfo::FKF_IsTarget)
+        Known = false;
+      Known &= addPoints(*Fixup.getValue(), Visited, Points);
+    }
+    break;
+  case MCFragment::FT_Dwarf:
+    Known = addPoints(cast<MCDwarfLineAddrFragment>(F).getAddrDelta(), Visited,
+                      Points);
+    break;
+  case MCFragment::FT_DwarfFrame:
+    Known = addPoints(cast<MCDwarfCallFrameFragment>(F).getAddrDelta(),
+                      Visited, Points);
+    break;
+  case MCFragment::FT_LEB:
+    Known = addPoints(cast<MCLEBFragment>(F).getValue(), Visited, Points);
+    break;
+  case MCFragment::FT_BoundaryAlign: {
+    // The padding depends on where the fragments it aligns start, and on
+    // where the last of them ends.
+    auto &BF = cast<MCBoundaryAlignFragment>(F);
+    if (!BF.getLastFragment())
+      return false;
+    Points.push_back(&BF);
+    if (const MCFragment *Next = BF.getLastFragment()->getNextNode())
+      Points.push_back(Next);
+    else
+      AlwaysVisit.push_back(&F);
+    Absolute = true;
+    break;
+  }
+  case MCFragment::FT_Fill:
+    if (isa<MCConstantExpr>(cast<MCFillFragment>(F).getNumValues()))
+      return false;
+    Known = addPoints(cast<MCFillFragment>(F).getNumValues(), Visited, Points);
+    break;
+  case MCFragment::FT_Org:
+    Points.push_back(&F);
+    Known = addPoints(cast<MCOrgFragment>(F).getOffset(), Visited, Points);
+    Absolute = true;
+    break;
+  case MCFragment::FT_CVInlineLines:
+  case MCFragment::FT_CVDefRange:
+    Known = false;
+    break;
+  }
+  if (!Known)
+    AlwaysVisit.push_back(&F);
+
+  // Record where the points are, section by section.
+  llvm::sort(Points, [](const MCFragment *A, const MCFragment *B) {
+    return std::make_pair(A->getParent()->getLayoutOrder(),
+                          A->getLayoutOrder()) <
+           std::make_pair(B->getParent()->getLayoutOrder(),
+                          B->getLayoutOrder());
+  });
+  for (auto I = Points.begin(), E = Points.end(); I != E;) {
+    const MCSection *Sec = (*I)->getParent();
+    auto Last = std::find_if(I, E, [&](const MCFragment *P) {
+      return P->getParent() != Sec;
+    });
+    SectionState &S = Sections[Sec->getLayoutOrder()];
+    unsigned Lo = (*I)->getLayoutOrder();
+    unsigned Hi = Last[-1]->getLayoutOrder();
+    // Points that are all in one fragment, such as a relaxable fragment
+    // alone in its section with the fixups it resolves against itself, are
+    // no interval: a symbol keeps its offset in its fragment, and labels past
+    // the start of a fragment are only defined in data fragments, which don't
+    // change size, so their distance never changes. Distances to other
+    // sections aren't folded during layout, and a relaxed fragment is visited
+    // again anyway.
+    if (Absolute) {
+      S.AbsoluteUsers.emplace_back(Hi, &F);
+    } else if (Hi - Lo > MaxShortSpan) {
+      S.LongIntervals.push_back({Lo, Hi, &F});
+    } else if (Lo != Hi) {
+      S.ShortIntervals.push_back({Lo, Hi, &F});
+      ++S.ShortBegin[Lo + 1];
+    }
+    I = Last;
+  }
+  return true;
+}
+
+bool MCAssembler::RelaxationWorklist::updateComputedSize(const MCFragment &F) {
+  // Measure the fragment again instead of reading its size off the layout of
+  // its section: a fragment can depend on fragments of other sections, and its
+  // own section's layout is only invalidated once it is known to have changed.
+  uint64_t Size = Asm.computeFragmentSize(Layout, F);
+  auto Inserted = ComputedSizes.try_emplace(&F, Size);
+  if (Inserted.second)
+    return true;
+  if (Inserted.first->second == Size)
+    return false;
+  Inserted.first->second = Size;
+  return true;
+}
+
+void MCAssembler::RelaxationWorklist::update(MCSection &Sec,
+                                             ArrayRef<unsigned> Changed) {
+  if (Changed.empty())
+    return;
+  SectionState &S = Sections[Sec.getLayoutOrder()];
+
+  // Everything after the first change moved.
+  for (auto I = llvm::partition_point(
+                S.AbsoluteUsers,
+                [&](const std::pair<unsigned, MCFragment *> &U) {
+                  return U.first <= Changed.front();
+                }),
+            E = S.AbsoluteUsers.end();
+       I != E; ++I)
+    enqueue(*I->second);
+
+  SmallVector<unsigned, 16> Resized;
+  std::merge(Changed.begin(), Changed.end(),
+             llvm::upper_bound(S.Aligns, Changed.front()), S.Aligns.end(),
+             std::back_inserter(Resized));
+
+  // Look for the intervals that contain a resized fragment.
+  for (unsigned C : Resized) {
+    unsigned First = C > MaxShortSpan ? C - MaxShortSpan : 0;
+    for (unsigned J = S.ShortBegin[First], E = S.ShortBegin[C + 1]; J != E;
+         ++J)
+      if (S.ShortIntervals[J].Hi > C)
+        enqueue(*S.ShortIntervals[J].User);
+  }
+  for (const Interval &I : S.LongIntervals) {
+    auto C = llvm::lower_bound(Resized, I.Lo);
+    if (C != Resized.end() && *C < I.Hi)
+      enqueue(*I.User);
+  }
+
+  for (MCFragment *F : AlwaysVisit)
+    enqueue(*F);
+}
+
 void MCAssembler::layout(MCAsmLayout &Layout) {
   assert(getBackendPtr() && "Expected assembler backend");
   DEBUG_WITH_TYPE("mc-dump", {
@@ -791,15 +1138,13 @@ void MCAssembler::layout(MCAsmLayout &Layout) {
       Frag.setLayoutOrder(FragmentIndex++);
   }
 
-  // Layout until everything fits.
-  while (layoutOnce(Layout)) {
+  // Layout until everything fits. Size of fragments in one section can depend
+  // on the size of fragments in another, the worklist keeps track of which
+  // fragments have to be relaxed again when a fragment changes size.
+  RelaxationWorklist Worklist(*this, Layout);
+  while (layoutOnce(Layout, Worklist)) {
     if (getContext().hadError())
       return;
-    // Size of fragments in one section can depend on the size of fragments in
-    // another. If any fragment has changed size, we have to re-layout (and
-    // as a result possibly further relax) all.
-    for (MCSection &Sec : *this)
-      Layout.invalidateFragmentsFrom(&*Sec.begin());
   }
 
   DEBUG_WITH_TYPE("mc-dump", {
@@ -1149,37 +1494,55 @@ bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
   }
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
+bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                                    RelaxationWorklist &Worklist) {
+  // Holds the first fragment which changed size during this layout. It will
+  // remain NULL if none were changed.
+  // When a fragment changes size, all the fragments following it should get
   // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
-
-  // Attempt to relax all the fragments in the section.
-  for (MCFragment &Frag : Sec) {
+  MCFragment *FirstChangedFragment = nullptr;
+  SmallVector<unsigned, 8> ChangedFragments;
+  SmallVector<MCFragment *, 8> RelaxedFragments;
+
+  // Attempt to relax the pending fragments in the section.
+  for (MCFragment *Frag = Worklist.takePending(Sec, nullptr); Frag;
+       Frag = Worklist.takePending(Sec, Frag)) {
+    ++stats::RelaxationVisits;
+    // The size of fill and org fragments is computed during layout, and may
+    // have changed now that what they depend on has moved.
+    bool Resized = (isa<MCFillFragment>(Frag) || isa<MCOrgFragment>(Frag)) &&
+                   Worklist.updateComputedSize(*Frag);
     // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = relaxFragment(Layout, Frag);
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = &Frag;
-  }
-  if (FirstRelaxedFragment) {
-    Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
+    bool RelaxedFrag = relaxFragment(Layout, *Frag);
+    if (RelaxedFrag)
+      RelaxedFragments.push_back(Frag);
+    if (!RelaxedFrag && !Resized)
+      continue;
+    if (!FirstChangedFragment)
+      FirstChangedFragment = Frag;
+    ChangedFragments.push_back(Frag->getLayoutOrder());
   }
-  return false;
+  if (!FirstChangedFragment)
+    return Worklist.hasPending(Sec);
+
+  Layout.invalidateFragmentsFrom(FirstChangedFragment);
+  // A relaxed fragment may have to be relaxed further.
+  for (MCFragment *Frag : RelaxedFragments)
+    Worklist.enqueue(*Frag);
+  Worklist.update(Sec, ChangedFragments);
+  return Worklist.hasPending(Sec);
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout,
+                             RelaxationWorklist &Worklist) {
   ++stats::RelaxationSteps;
 
-  bool WasRelaxed = false;
   for (MCSection &Sec : *this) {
-    while (layoutSectionOnce(Layout, Sec))
-      WasRelaxed = true;
+    while (layoutSectionOnce(Layout, Sec, Worklist))
+      ;
   }
 
-  return WasRelaxed;
+  return Worklist.hasPending();
 }
 
 void MCAssembler::finishLayout(MCAsmLayout &Layout) {
@@ -0,0 +1,457 @@
+//===- CachingFunctionPassAdaptor.cpp - Reuse optimized function bodies ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the CachingModuleToFunctionPassAdaptor. Each function
+/// is copied into a module of its own within the same context, sharing the
+/// metadata of the original. The cache key is the SHA1 of that module's
+/// bitcode; the entry is the bitcode of the module after the pipeline ran
+/// over it. Cache hits and misses are merged back the same way, from bitcode,
+/// so they produce the same IR.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Passes/CachingFunctionPassAdaptor.h"
+#include "FunctionBodyMerging.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/VCSRevision.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "cached-function"
+
+STATISTIC(NumCacheHits,
+          "Number of functions whose body was found in the cache");
+STATISTIC(NumCacheMisses,
+          "Number of functions optimized and added to the cache");
+STATISTIC(NumUncached, "Number of functions that can't be cached");
+
+/// Returns true if \p C is, or is built from, a global value.
+static bool containsGlobalValue(const Constant *C) {
+  if (isa<GlobalValue>(C) || isa<BlockAddress>(C))
+    return true;
+  return any_of(C->operands(), [](const Use &Op) {
+    return containsGlobalValue(cast<Constant>(Op.get()));
+  });
+}
+
+namespace {
+
+/// Copies functions into modules of their own, along with the context the
+/// pipeline may look at.
+class FunctionExtractor {
+public:
+  FunctionExtractor(Module &M);
+
+  /// Returns a module holding a copy of \p F, or null if \p F can't be moved
+  /// into a module of its own. \p Orig receives the counterparts of the global
+  /// values of the new module.
+  std::unique_ptr<Module> extract(Function &F, SplitModuleState &Orig);
+
+private:
+  bool referencesGlobalValues(Metadata *MD);
+
+  Module &M;
+  /// Metadata known not to refer to any global value.
+  SmallPtrSet<const Metadata *, 32> Clean;
+  SmallVector<MDNode *, 8> ModuleFlags;
+  SmallVector<MDNode *, 2> CompileUnits;
+  bool CompileUnitsAreClean = true;
+};
+
+} // end anonymous namespace
+
+FunctionExtractor::FunctionExtractor(Module &M) : M(M) {
+  // Metadata in the new module is shared with M, so it must not refer to any
+  // of M's global values. Flags that do, such as the call graph profile,
+  // don't concern function passes and are left out.
+  if (NamedMDNode *Flags = M.getModuleFlagsMetadata())
+    for (MDNode *Flag : Flags->operands())
+      if (!referencesGlobalValues(Flag))
+        ModuleFlags.push_back(Flag);
+  if (NamedMDNode *CUs = M.getNamedMetadata("llvm.dbg.cu"))
+    for (MDNode *CU : CUs->operands()) {
+      CompileUnits.push_back(CU);
+      CompileUnitsAreClean &= !referencesGlobalValues(CU);
+    }
+}
+
+bool FunctionExtractor::referencesGlobalValues(Metadata *MD) {
+  SmallVector<const Metadata *, 16> Worklist{MD};
+  SmallVector<const Metadata *, 16> Visited;
+  while (!Worklist.empty()) {
+    const Metadata *N = Worklist.pop_back_val();
+    if (!N || !Clean.insert(N).second)
+      continue;
+    Visited.push_back(N);
+    if (auto *CMD = dyn_cast<ConstantAsMetadata>(N)) {
+      if (containsGlobalValue(CMD->getValue())) {
+        // Whatever was visited on the way isn't known to be clean.
+        for (const Metadata *V : Visited)
+          Clean.erase(V);
+        return true;
+      }
+      continue;
+    }
+    if (auto *Node = dyn_cast<MDNode>(N))
+      for (const MDOperand &Op : Node->operands())
+        Worklist.push_back(Op.get());
+  }
+  return false;
+}
+
+std::unique_ptr<Module> FunctionExtractor::extract(Function &F,
+                                                   SplitModuleState &Orig) {
+  // Prefix and prologue data aren't remapped when cloning.
+  if (!CompileUnitsAreClean || F.hasPrefixData() || F.hasPrologueData())
+    return nullptr;
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  auto HasForeignAttachments = [&](auto &V) {
+    MDs.clear();
+    V.getAllMetadata(MDs);
+    return any_of(MDs, [&](const std::pair<unsigned, MDNode *> &Attachment) {
+      return referencesGlobalValues(Attachment.second);
+    });
+  };
+  if (HasForeignAttachments(F))
+    return nullptr;
+  for (Instruction &I : instructions(F)) {
+    if (HasForeignAttachments(I))
+      return nullptr;
+    for (const Use &Op : I.operands())
+      if (auto *MAV = dyn_cast<MetadataAsValue>(Op))
+        if (referencesGlobalValues(MAV->getMetadata()))
+          return nullptr;
+  }
+
+  auto E = std::make_unique<Module>("<cached-function>", M.getContext());
+  E->setDataLayout(M.getDataLayout());
+  E->setTargetTriple(M.getTargetTriple());
+  if (!ModuleFlags.empty()) {
+    NamedMDNode *Flags = E->getOrInsertModuleFlagsMetadata();
+    for (MDNode *Flag : ModuleFlags)
+      Flags->addOperand(Flag);
+  }
+  if (!CompileUnits.empty()) {
+    NamedMDNode *CUs = E->getOrInsertNamedMetadata("llvm.dbg.cu");
+    for (MDNode *CU : CompileUnits)
+      CUs->addOperand(CU);
+  }
+
+  ValueToValueMapTy VMap;
+  Function *NewF = Function::Create(F.getFunctionType(), F.getLinkage(),
+                                    F.getAddressSpace(), F.getName(), E.get());
+  VMap[&F] = NewF;
+  Orig.Functions.push_back(&F);
+
+  // Declare the global values F refers to, and define the constants among
+  // them, whose initializers the passes may fold.
+  SmallVector<const Constant *, 32> Worklist;
+  SmallPtrSet<const Constant *, 32> Visited;
+  SmallVector<std::pair<GlobalVariable *, GlobalVariable *>, 8> Definitions;
+  auto MapGlobal = [&](GlobalValue &GV) {
+    if (VMap.count(&GV))
+      return;
+    Type *ValueTy = GV.getValueType();
+    if (auto *FTy = dyn_cast<FunctionType>(ValueTy)) {
+      Function *NewFn =
+          Function::Create(FTy, GlobalValue::ExternalLinkage,
+                           GV.getAddressSpace(), GV.getName(), E.get());
+      if (auto *Fn = dyn_cast<Function>(&GV)) {
+        NewFn->setCallingConv(Fn->getCallingConv());
+        NewFn->setAttributes(Fn->getAttributes());
+      }
+      VMap[&GV] = NewFn;
+      Orig.Functions.push_back(&GV);
+      return;
+    }
+
+    auto *Var = dyn_cast<GlobalVariable>(&GV);
+    auto *NewVar = new GlobalVariable(
+        *E, ValueTy, Var && Var->isConstant(), GlobalValue::ExternalLinkage,
+        /*Initializer=*/nullptr, GV.getName(), /*InsertBefore=*/nullptr,
+        GV.getThreadLocalMode(), GV.getAddressSpace());
+    VMap[&GV] = NewVar;
+    Orig.Globals.push_back(&GV);
+    if (!Var)
+      return;
+    NewVar->copyAttributesFrom(Var);
+    if (Var->isConstant() && Var->hasDefinitiveInitializer()) {
+      NewVar->setLinkage(Var->getLinkage());
+      Definitions.emplace_back(Var, NewVar);
+      Worklist.push_back(Var->getInitializer());
+    }
+  };
+  auto MapConstants = [&]() {
+    while (!Worklist.empty()) {
+      const Constant *C = Worklist.pop_back_val();
+      if (!Visited.insert(C).second)
+        continue;
+      if (auto *GV = dyn_cast<GlobalValue>(C)) {
+        MapGlobal(*const_cast<GlobalValue *>(GV));
+        continue;
+      }
+      for (const Use &Op : C->operands())
+        if (auto *OpC = dyn_cast<Constant>(Op))
+          Worklist.push_back(OpC);
+    }
+  };
+
+  if (F.hasPersonalityFn()) {
+    Worklist.push_back(F.getPersonalityFn());
+    MapConstants();
+  }
+  for (Instruction &I : instructions(F))
+    for (const Use &Op : I.operands())
+      if (auto *C = dyn_cast<Constant>(Op)) {
+        Worklist.push_back(C);
+        MapConstants();
+      }
+
+  for (auto &P : Definitions)
+    P.second->setInitializer(MapValue(P.first->getInitializer(), VMap));
+
+  Function::arg_iterator DestArg = NewF->arg_begin();
+  for (Argument &Arg : F.args()) {
+    DestArg->setName(Arg.getName());
+    VMap[&Arg] = &*DestArg++;
+  }
+  SmallVector<ReturnInst *, 8> Returns;
+  CloneFunctionInto(NewF, &F, VMap, /*ModuleLevelChanges=*/false, Returns);
+  return E;
+}
+
+/// Returns the part of the cache key that is the same for every function.
+static std::string getKeyPrefix(StringRef PipelineKey, const TargetMachine *TM,
+                                const PipelineTuningOptions &PTO) {
+  std::string Prefix;
+  raw_string_ostream OS(Prefix);
+  // The same pipeline may optimize differently in another compiler version.
+  OS << LLVM_VERSION_STRING << ';';
+#ifdef LLVM_REVISION
+  OS << LLVM_REVISION << ';';
+#endif
+  OS << PipelineKey << ';';
+  if (TM)
+    OS << TM->getTargetTriple().str() << ';' << TM->getTargetCPU() << ';'
+       << TM->getTargetFeatureString() << ';'
+       << static_cast<int>(TM->getOptLevel()) << ';'
+       << static_cast<int>(TM->getRelocationModel()) << ';'
+       << static_cast<int>(TM->getCodeModel());
+  OS << ';' << PTO.LoopInterleaving << PTO.LoopVectorization
+     << PTO.SLPVectorization << PTO.LoopUnrolling
+     << PTO.ForgetAllSCEVInLoopUnroll << PTO.Coroutines << ';'
+     << PTO.LicmMssaOptCap << ';' << PTO.LicmMssaNoAccForPromotionCap << ';'
+     << PTO.CallGraphProfile;
+  return OS.str();
+}
+
+/// Returns the cache key of the extracted module \p E. The declarations in
+/// \p E don't carry the linkage of their counterparts, so that is added.
+static std::string getKey(StringRef KeyPrefix, const Module &E,
+                          const SplitModuleState &Orig) {
+  std::string Linkage;
+  raw_string_ostream OS(Linkage);
+  for (const auto *GVs : {&Orig.Globals, &Orig.Functions})
+    for (const GlobalValue *GV : *GVs)
+      OS << GV->getValueID() << ',' << GV->getLinkage() << ','
+         << GV->getVisibility() << ',' << GV->getDLLStorageClass() << ','
+         << static_cast<int>(GV->getUnnamedAddr()) << ',' << GV->isDSOLocal()
+         << ';';
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream BOS(Bitcode);
+    WriteBitcodeToFile(E, BOS, /*ShouldPreserveUseListOrder=*/true);
+  }
+
+  SHA1 Hasher;
+  Hasher.update(KeyPrefix);
+  Hasher.update(OS.str());
+  Hasher.update(ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(Bitcode.data()), Bitcode.size()));
+  return toHex(Hasher.result());
+}
+
+/// Writes \p Data to the cache entry at \p EntryPath. The entry is written to
+/// a temporary file that is renamed into place, so that concurrent readers
+/// (possibly in other processes) never see a partial entry. Failures only
+/// cost a later cache miss, so they are ignored.
+static void writeCacheEntry(StringRef CacheDir, StringRef EntryPath,
+                            StringRef Data) {
+  SmallString<128> TempFilenameModel;
+  sys::path::append(TempFilenameModel, CacheDir, "Function-%%%%%%.tmp.bc");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+      TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Data;
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return;
+    }
+  }
+
+  if (Error Err = Temp->keep(EntryPath)) {
+    consumeError(std::move(Err));
+    consumeError(Temp->discard());
+  }
+}
+
+namespace {
+
+/// The pipeline run over the extracted functions, built on first use. Its
+/// analysis managers are cleared after every function, since the modules they
+/// cached results for go away.
+struct ExtractedPipeline {
+  ExtractedPipeline(TargetMachine *TM, const PipelineTuningOptions &PTO)
+      : PB(TM, PTO) {
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+  }
+
+  PassBuilder PB;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  FunctionPassManager FPM;
+};
+
+} // end anonymous namespace
+
+PreservedAnalyses
+CachingModuleToFunctionPassAdaptor::run(Module &M, ModuleAnalysisManager &AM) {
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+  // If the directory can't be created, every function is a miss.
+  sys::fs::create_directories(CacheDir);
+  std::string KeyPrefix = getKeyPrefix(PipelineKey, TM, PTO);
+
+  SmallPtrSet<const Function *, 4> BlockAddressFns;
+  findBlockAddressFunctions(M, BlockAddressFns);
+
+  std::vector<Function *> Definitions;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Definitions.push_back(&F);
+
+  FunctionExtractor Extractor(M);
+  std::unique_ptr<ExtractedPipeline> Pipeline;
+  std::vector<Function *> InPlace;
+  bool Changed = false;
+  for (Function *F : Definitions) {
+    SplitModuleState Orig;
+    std::unique_ptr<Module> E;
+    if (!BlockAddressFns.count(F))
+      E = Extractor.extract(*F, Orig);
+    if (!E) {
+      ++NumUncached;
+      InPlace.push_back(F);
+      continue;
+    }
+
+    // The copy of F is the first function of E.
+    const unsigned NewFIndex = 0;
+    Function *NewF = &*E->begin();
+    std::vector<MDNode *> Distinct;
+    collectSplitDistinctMetadata(*E, NewF, Distinct);
+
+    SmallString<128> EntryPath;
+    sys::path::append(EntryPath, CacheDir,
+                      "llvmcache-" + getKey(KeyPrefix, *E, Orig));
+
+    // The analyses cached for F don't describe its new body.
+    auto Merge = [&](StringRef Bitcode) -> Error {
+      if (Error Err = mergeSplitModule(M, Bitcode, Orig, NewFIndex, Distinct))
+        return Err;
+      FAM.clear(*F, F->getName());
+      Changed = true;
+      return Error::success();
+    };
+
+    // Update the access time so that entries in use survive pruning. An entry
+    // that can't be read or merged is simply replaced.
+    Expected<sys::fs::file_t> FDOrErr =
+        sys::fs::openNativeFileForRead(EntryPath, sys::fs::OF_UpdateAtime);
+    if (FDOrErr) {
+      ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+          MemoryBuffer::getOpenFile(*FDOrErr, EntryPath,
+                                    /*FileSize=*/-1,
+                                    /*RequiresNullTerminator=*/false);
+      sys::fs::closeFile(*FDOrErr);
+      if (MBOrErr) {
+        if (Error Err = Merge((*MBOrErr)->getBuffer()))
+          consumeError(std::move(Err));
+        else {
+          ++NumCacheHits;
+          continue;
+        }
+      }
+    } else {
+      consumeError(FDOrErr.takeError());
+    }
+
+    ++NumCacheMisses;
+    if (!Pipeline) {
+      Pipeline = std::make_unique<ExtractedPipeline>(TM, PTO);
+      if (Error Err = BuildPipeline(Pipeline->PB, Pipeline->FPM))
+        report_fatal_error("cached-function: " + toString(std::move(Err)));
+    }
+    Pipeline->FPM.run(*NewF, Pipeline->FAM);
+    Pipeline->FAM.clear();
+    Pipeline->MAM.clear();
+
+    NamedMDNode *NMD = E->getOrInsertNamedMetadata(SplitDistinctMDName);
+    for (MDNode *N : Distinct)
+      NMD->addOperand(N);
+    SmallVector<char, 0> Result;
+    {
+      raw_svector_ostream OS(Result);
+      WriteBitcodeToFile(*E, OS, /*ShouldPreserveUseListOrder=*/true);
+    }
+    StringRef ResultRef(Result.data(), Result.size());
+    writeCacheEntry(CacheDir, EntryPath, ResultRef);
+    if (Error Err = Merge(ResultRef))
+      report_fatal_error("cached-function: " + toString(std::move(Err)));
+  }
+
+  pruneCache(CacheDir, Policy);
+
+  PreservedAnalyses PA = runFunctionPassInPlace(InPlacePass, InPlace, M, AM);
+  // The merged functions have new bodies and arguments, nothing on them is
+  // preserved.
+  return Changed ? PreservedAnalyses::none() : PA;
+}
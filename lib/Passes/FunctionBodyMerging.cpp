@@ -0,0 +1,375 @@
+//===- FunctionBodyMerging.cpp - Move optimized bodies between modules ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "FunctionBodyMerging.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+using namespace llvm;
+
+const char llvm::SplitDistinctMDName[] = "llvm.split-module.distinct";
+
+static const RemapFlags MergeFlags =
+    RF_IgnoreMissingLocals | RF_MoveDistinctMDs;
+
+void llvm::collectSplitDistinctMetadata(Module &M, ArrayRef<Function *> Fns,
+                                        std::vector<MDNode *> &Distinct) {
+  SmallPtrSet<const MDNode *, 32> Visited;
+  SmallVector<MDNode *, 16> Worklist;
+  auto Visit = [&](Metadata *MD) {
+    auto *Root = dyn_cast_or_null<MDNode>(MD);
+    if (!Root || !Visited.insert(Root).second)
+      return;
+    Worklist.push_back(Root);
+    while (!Worklist.empty()) {
+      MDNode *N = Worklist.pop_back_val();
+      if (N->isDistinct())
+        Distinct.push_back(N);
+      for (const MDOperand &Op : reverse(N->operands()))
+        if (auto *OpN = dyn_cast_or_null<MDNode>(Op.get()))
+          if (Visited.insert(OpN).second)
+            Worklist.push_back(OpN);
+    }
+  };
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  auto VisitAttachments = [&](auto &V) {
+    MDs.clear();
+    V.getAllMetadata(MDs);
+    for (auto &Attachment : MDs)
+      Visit(Attachment.second);
+  };
+
+  for (NamedMDNode &NMD : M.named_metadata())
+    for (MDNode *N : NMD.operands())
+      Visit(N);
+  for (GlobalVariable &GV : M.globals())
+    VisitAttachments(GV);
+  for (Function *F : Fns) {
+    VisitAttachments(*F);
+    for (Instruction &I : instructions(F)) {
+      VisitAttachments(I);
+      for (const Use &Op : I.operands())
+        if (auto *MAV = dyn_cast<MetadataAsValue>(Op))
+          Visit(MAV->getMetadata());
+    }
+  }
+}
+
+namespace {
+
+/// Maps the types of a split module, loaded into the context of the module it
+/// was split from, back to the original types. Named struct types are the
+/// only ones that differ: the bitcode reader gives each of them a ".N" suffix
+/// because the original type still holds its name.
+class SplitTypeMapper : public ValueMapTypeRemapper {
+public:
+  SplitTypeMapper(Module &M) : M(M) {}
+
+  Type *remapType(Type *SrcTy) override;
+
+  /// Drops the names of the mapped struct types, so that they don't pile up
+  /// in the context's symbol table.
+  void releaseNames() {
+    for (StructType *STy : Renamed)
+      STy->setName("");
+  }
+
+private:
+  Module &M;
+  DenseMap<Type *, Type *> MappedTypes;
+  SmallVector<StructType *, 16> Renamed;
+};
+
+} // end anonymous namespace
+
+Type *SplitTypeMapper::remapType(Type *SrcTy) {
+  auto It = MappedTypes.find(SrcTy);
+  if (It != MappedTypes.end())
+    return It->second;
+
+  Type *Result = SrcTy;
+  auto *STy = dyn_cast<StructType>(SrcTy);
+  if (STy && !STy->isLiteral()) {
+    StringRef Name = STy->getName();
+    size_t Dot = Name.rfind('.');
+    unsigned Suffix;
+    if (Dot != StringRef::npos &&
+        !Name.substr(Dot + 1).getAsInteger(10, Suffix)) {
+      StructType *Orig = M.getTypeByName(Name.substr(0, Dot));
+      if (Orig && Orig != STy && Orig->isOpaque() == STy->isOpaque() &&
+          (Orig->isOpaque() ||
+           Orig->getNumElements() == STy->getNumElements())) {
+        Result = Orig;
+        Renamed.push_back(STy);
+      }
+    }
+  } else if (SrcTy->getNumContainedTypes()) {
+    SmallVector<Type *, 4> ElementTypes;
+    bool AnyChange = false;
+    for (Type *ElementTy : SrcTy->subtypes()) {
+      ElementTypes.push_back(remapType(ElementTy));
+      AnyChange |= ElementTypes.back() != ElementTy;
+    }
+    if (AnyChange) {
+      switch (SrcTy->getTypeID()) {
+      default:
+        llvm_unreachable("unknown derived type to remap");
+      case Type::ArrayTyID:
+        Result = ArrayType::get(ElementTypes[0],
+                                cast<ArrayType>(SrcTy)->getNumElements());
+        break;
+      case Type::ScalableVectorTyID:
+      case Type::FixedVectorTyID:
+        Result = VectorType::get(ElementTypes[0],
+                                 cast<VectorType>(SrcTy)->getElementCount());
+        break;
+      case Type::PointerTyID:
+        Result = PointerType::get(ElementTypes[0],
+                                  cast<PointerType>(SrcTy)->getAddressSpace());
+        break;
+      case Type::FunctionTyID:
+        Result = FunctionType::get(ElementTypes[0],
+                                   makeArrayRef(ElementTypes).slice(1),
+                                   cast<FunctionType>(SrcTy)->isVarArg());
+        break;
+      case Type::StructTyID:
+        Result = StructType::get(SrcTy->getContext(), ElementTypes,
+                                 cast<StructType>(SrcTy)->isPacked());
+        break;
+      }
+    }
+  }
+  return MappedTypes[SrcTy] = Result;
+}
+
+/// Rewrites the byval types of \p Attrs with \p TypeMapper.
+static AttributeList remapByValTypes(LLVMContext &C, AttributeList Attrs,
+                                     SplitTypeMapper &TypeMapper) {
+  for (unsigned I = 0, E = Attrs.getNumAttrSets(); I != E; ++I) {
+    if (!Attrs.hasAttribute(I, Attribute::ByVal))
+      continue;
+    Type *Ty = Attrs.getAttribute(I, Attribute::ByVal).getValueAsType();
+    if (!Ty)
+      continue;
+    Attrs = Attrs.removeAttribute(C, I, Attribute::ByVal);
+    Attrs = Attrs.addAttribute(
+        C, I, Attribute::getWithByValType(C, TypeMapper.remapType(Ty)));
+  }
+  return Attrs;
+}
+
+/// Returns the counterpart in \p M of a global value that a pass added to a
+/// split module, creating it if needed. Initializers and bodies are moved
+/// over later, once every global value has been mapped.
+static Constant *getOrCreateGlobal(Module &M, GlobalValue &SrcGV,
+                                   SplitTypeMapper &TypeMapper) {
+  Type *Ty = TypeMapper.remapType(SrcGV.getType());
+  if (!SrcGV.hasLocalLinkage())
+    if (GlobalValue *Existing = M.getNamedValue(SrcGV.getName()))
+      return ConstantExpr::getPointerBitCastOrAddrSpaceCast(Existing, Ty);
+
+  GlobalObject *NewGO;
+  if (auto *SrcF = dyn_cast<Function>(&SrcGV)) {
+    auto *NewF = Function::Create(
+        cast<FunctionType>(TypeMapper.remapType(SrcF->getFunctionType())),
+        SrcF->getLinkage(), SrcF->getAddressSpace(), SrcF->getName(), &M);
+    NewF->copyAttributesFrom(SrcF);
+    NewF->setAttributes(
+        remapByValTypes(M.getContext(), NewF->getAttributes(), TypeMapper));
+    NewGO = NewF;
+  } else {
+    auto *SrcVar = cast<GlobalVariable>(&SrcGV);
+    auto *NewVar = new GlobalVariable(
+        M, TypeMapper.remapType(SrcVar->getValueType()), SrcVar->isConstant(),
+        SrcVar->getLinkage(), /*Initializer=*/nullptr, SrcVar->getName(),
+        /*InsertBefore=*/nullptr, SrcVar->getThreadLocalMode(),
+        SrcVar->getAddressSpace());
+    NewVar->copyAttributesFrom(SrcVar);
+    NewGO = NewVar;
+  }
+
+  // The comdat belongs to the split module, look up ours by name.
+  NewGO->setComdat(nullptr);
+  if (const Comdat *SrcC = cast<GlobalObject>(SrcGV).getComdat()) {
+    Comdat *C = M.getOrInsertComdat(SrcC->getName());
+    C->setSelectionKind(SrcC->getSelectionKind());
+    NewGO->setComdat(C);
+  }
+  return NewGO;
+}
+
+/// Replaces the body of \p Dst with the body of \p Src, the same function in a
+/// split module.
+static void moveFunctionBody(Function &Dst, Function &Src,
+                             ValueToValueMapTy &VMap,
+                             SplitTypeMapper &TypeMapper) {
+  Dst.dropAllReferences();
+
+  // Link in the operands without remapping.
+  if (Src.hasPrefixData())
+    Dst.setPrefixData(Src.getPrefixData());
+  if (Src.hasPrologueData())
+    Dst.setPrologueData(Src.getPrologueData());
+  if (Src.hasPersonalityFn())
+    Dst.setPersonalityFn(Src.getPersonalityFn());
+
+  // Copy over the metadata attachments without remapping.
+  Dst.copyMetadata(&Src, 0);
+
+  // Steal arguments and splice the body of Src into Dst.
+  Dst.stealArgumentListFrom(Src);
+  Dst.getBasicBlockList().splice(Dst.end(), Src.getBasicBlockList());
+
+  // Everything has been moved over. Remap it.
+  ValueMapper(VMap, MergeFlags, &TypeMapper).remapFunction(Dst);
+}
+
+Error llvm::mergeSplitModule(Module &M, StringRef Bitcode,
+                             const SplitModuleState &Orig,
+                             ArrayRef<unsigned> Indices,
+                             ArrayRef<MDNode *> OrigDistinct) {
+  Expected<std::unique_ptr<Module>> SrcOrErr = parseBitcodeFile(
+      MemoryBufferRef(Bitcode, "<split-module>"), M.getContext());
+  if (!SrcOrErr)
+    return SrcOrErr.takeError();
+  Module &Src = **SrcOrErr;
+
+  std::vector<Function *> SrcFns;
+  for (Function &F : Src)
+    SrcFns.push_back(&F);
+  if (Src.global_size() < Orig.Globals.size() ||
+      SrcFns.size() < Orig.Functions.size() ||
+      Src.alias_size() + Src.ifunc_size() != Orig.IndirectSymbols.size())
+    return createStringError(inconvertibleErrorCode(),
+                             "function passes removed or added global values");
+
+  ValueToValueMapTy VMap;
+  SplitTypeMapper TypeMapper(M);
+
+  // Global values that were there when the module was split map back by
+  // position, the rest were created by the passes.
+  std::vector<std::pair<GlobalValue *, Constant *>> NewGlobals;
+  auto MapGlobal = [&](GlobalValue &SrcGV, GlobalValue *OrigGV) {
+    if (OrigGV) {
+      VMap[&SrcGV] = OrigGV;
+      // Passes may raise the alignment of a variable they know the definition
+      // of, and rely on it.
+      auto *SrcVar = dyn_cast<GlobalVariable>(&SrcGV);
+      auto *OrigVar = dyn_cast<GlobalVariable>(OrigGV);
+      if (SrcVar && OrigVar && !OrigVar->isDeclaration() &&
+          SrcVar->getAlignment() > OrigVar->getAlignment())
+        OrigVar->setAlignment(SrcVar->getAlign());
+      return;
+    }
+    Constant *NewGV = getOrCreateGlobal(M, SrcGV, TypeMapper);
+    VMap[&SrcGV] = NewGV;
+    NewGlobals.emplace_back(&SrcGV, NewGV);
+  };
+  unsigned Idx = 0;
+  for (GlobalVariable &GV : Src.globals()) {
+    MapGlobal(GV, Idx < Orig.Globals.size() ? Orig.Globals[Idx] : nullptr);
+    ++Idx;
+  }
+  for (Idx = 0; Idx != SrcFns.size(); ++Idx)
+    MapGlobal(*SrcFns[Idx],
+              Idx < Orig.Functions.size() ? Orig.Functions[Idx] : nullptr);
+  Idx = 0;
+  for (GlobalAlias &GA : Src.aliases())
+    VMap[&GA] = Orig.IndirectSymbols[Idx++];
+  for (GlobalIFunc &GI : Src.ifuncs())
+    VMap[&GI] = Orig.IndirectSymbols[Idx++];
+
+  // Map the distinct metadata the split module started out with back to the
+  // originals, so debug info isn't duplicated for every split module.
+  if (NamedMDNode *NMD = Src.getNamedMetadata(SplitDistinctMDName)) {
+    if (NMD->getNumOperands() == OrigDistinct.size())
+      for (unsigned I = 0, E = NMD->getNumOperands(); I != E; ++I)
+        VMap.MD()[NMD->getOperand(I)].reset(OrigDistinct[I]);
+    Src.eraseNamedMetadata(NMD);
+  }
+
+  for (auto &P : NewGlobals) {
+    if (auto *SrcVar = dyn_cast<GlobalVariable>(P.first)) {
+      auto *NewVar = dyn_cast<GlobalVariable>(P.second);
+      if (NewVar && SrcVar->hasInitializer())
+        NewVar->setInitializer(MapValue(SrcVar->getInitializer(), VMap,
+                                        MergeFlags, &TypeMapper));
+      continue;
+    }
+    auto *SrcF = cast<Function>(P.first);
+    if (auto *NewF = dyn_cast<Function>(P.second))
+      if (!SrcF->isDeclaration())
+        moveFunctionBody(*NewF, *SrcF, VMap, TypeMapper);
+  }
+
+  for (unsigned I : Indices)
+    moveFunctionBody(*cast<Function>(Orig.Functions[I]), *SrcFns[I], VMap,
+                     TypeMapper);
+
+  TypeMapper.releaseNames();
+  return Error::success();
+}
+
+PreservedAnalyses llvm::runFunctionPassInPlace(FunctionPassManager &Pass,
+                                               ArrayRef<Function *> Fns,
+                                               Module &M,
+                                               ModuleAnalysisManager &AM) {
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  PassInstrumentation PI = AM.getResult<PassInstrumentationAnalysis>(M);
+
+  PreservedAnalyses PA = PreservedAnalyses::all();
+  for (Function *F : Fns) {
+    if (!PI.runBeforePass<Function>(Pass, *F))
+      continue;
+
+    PreservedAnalyses PassPA;
+    {
+      TimeTraceScope TimeScope(Pass.name(), F->getName());
+      PassPA = Pass.run(*F, FAM);
+    }
+
+    PI.runAfterPass(Pass, *F);
+    FAM.invalidate(*F, PassPA);
+    PA.intersect(std::move(PassPA));
+  }
+
+  PA.preserveSet<AllAnalysesOn<Function>>();
+  PA.preserve<FunctionAnalysisManagerModuleProxy>();
+  return PA;
+}
+
+void llvm::findBlockAddressFunctions(Module &M,
+                                     SmallPtrSetImpl<const Function *> &Fns) {
+  SmallVector<const User *, 8> Worklist;
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      if (BB.hasAddressTaken()) {
+        Fns.insert(&F);
+        Worklist.append(BB.user_begin(), BB.user_end());
+      }
+
+  SmallPtrSet<const User *, 8> Visited;
+  while (!Worklist.empty()) {
+    const User *U = Worklist.pop_back_val();
+    if (!Visited.insert(U).second)
+      continue;
+    if (auto *I = dyn_cast<Instruction>(U))
+      Fns.insert(I->getFunction());
+    else if (!isa<GlobalValue>(U))
+      Worklist.append(U->user_begin(), U->user_end());
+  }
+}
@@ -0,0 +1,84 @@
+//===- FunctionBodyMerging.h - Move optimized bodies between modules ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// Helpers shared by the function pass adaptors that optimize functions in a
+/// module split off from the one they belong to, and then move the optimized
+/// bodies back.
+///
+/// Bodies are merged back by position: the bitcode writer and reader keep the
+/// order of the global values of a module, and function passes don't remove
+/// any, so the N-th function of the split module is the counterpart of the
+/// N-th function recorded when it was split. The same holds for the distinct
+/// metadata nodes reachable from the bodies, which are collected in the same
+/// order on both sides.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_PASSES_FUNCTIONBODYMERGING_H
+#define LLVM_LIB_PASSES_FUNCTIONBODYMERGING_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/Error.h"
+
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class GlobalValue;
+class MDNode;
+class Module;
+
+/// The named metadata a split module uses to hand back the distinct metadata
+/// nodes it started out with, in the order of collectSplitDistinctMetadata().
+extern const char SplitDistinctMDName[];
+
+/// The counterparts of the global values of a split module at the time it was
+/// split, in the order the split module has them. A split module may stand in
+/// for an alias with a declaration, so these aren't necessarily of the same
+/// kind.
+struct SplitModuleState {
+  std::vector<GlobalValue *> Globals;
+  std::vector<GlobalValue *> Functions;
+  std::vector<GlobalValue *> IndirectSymbols;
+};
+
+/// Collects the distinct metadata nodes reachable from the module-level
+/// metadata of \p M and from \p Fns into \p Distinct. The order only depends
+/// on the structure of the IR, so it is the same after a bitcode round trip.
+void collectSplitDistinctMetadata(Module &M, ArrayRef<Function *> Fns,
+                                  std::vector<MDNode *> &Distinct);
+
+/// Loads the split module in \p Bitcode into the context of \p M, and moves
+/// the bodies of its functions at \p Indices into their counterparts in \p M,
+/// along with the global values its passes created. \p OrigDistinct is what
+/// collectSplitDistinctMetadata() returned for the split module before it was
+/// optimized. Nothing in \p M is changed if an error is returned.
+Error mergeSplitModule(Module &M, StringRef Bitcode,
+                       const SplitModuleState &Orig,
+                       ArrayRef<unsigned> Indices,
+                       ArrayRef<MDNode *> OrigDistinct);
+
+/// Runs \p Pass over \p Fns in place, the same way ModuleToFunctionPassAdaptor
+/// does.
+PreservedAnalyses runFunctionPassInPlace(FunctionPassManager &Pass,
+                                         ArrayRef<Function *> Fns, Module &M,
+                                         ModuleAnalysisManager &AM);
+
+/// Collects the functions whose bodies can't be moved between modules: those
+/// with blocks that have their address taken, and those referring to them.
+void findBlockAddressFunctions(Module &M,
+                               SmallPtrSetImpl<const Function *> &Fns);
+
+} // end namespace llvm
+
+#endif // LLVM_LIB_PASSES_FUNCTIONBODYMERGING_H
@@ -0,0 +1,207 @@
+//===- ParallelFunctionPassAdaptor.cpp - Run function passes on threads ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the ParallelModuleToFunctionPassAdaptor. The module is
+/// split by serializing it once; every worker thread loads the bodies of its
+/// partition lazily from the shared bitcode, so there is no per-partition
+/// cloning on the calling thread. The results are merged back with the
+/// helpers in FunctionBodyMerging.h.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Passes/ParallelFunctionPassAdaptor.h"
+#include "FunctionBodyMerging.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+/// Runs the pipeline over the functions at \p Indices of the module in
+/// \p Bitcode, in a context of its own, and writes the result to \p Result.
+static Error
+runPartition(StringRef Bitcode, ArrayRef<unsigned> Indices,
+             const ParallelModuleToFunctionPassAdaptor::PipelineBuilderT
+                 &BuildPipeline,
+             TargetMachine *TM, const PipelineTuningOptions &PTO,
+             bool DiscardValueNames, SmallVectorImpl<char> &Result) {
+  LLVMContext Ctx;
+  Ctx.setDiscardValueNames(DiscardValueNames);
+  Expected<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(
+      MemoryBufferRef(Bitcode, "<parallel-function>"), Ctx);
+  if (!MOrErr)
+    return MOrErr.takeError();
+  Module &M = **MOrErr;
+  if (Error Err = M.materializeMetadata())
+    return Err;
+
+  std::vector<Function *> Fns;
+  for (Function &F : M)
+    Fns.push_back(&F);
+  std::vector<Function *> Partition;
+  for (unsigned Idx : Indices) {
+    Partition.push_back(Fns[Idx]);
+    if (Error Err = Fns[Idx]->materialize())
+      return Err;
+  }
+
+  // Turn the rest of the functions into declarations. Functions that have
+  // been materialized already because a global initializer refers to their
+  // blocks keep their bodies, dropping them would fold those blockaddresses.
+  for (Function *F : Fns) {
+    if (!F->isMaterializable())
+      continue;
+    F->dropAllReferences();
+    F->setLinkage(GlobalValue::ExternalLinkage);
+    F->setComdat(nullptr);
+  }
+  if (Error Err = M.materializeAll())
+    return Err;
+
+  std::vector<MDNode *> Distinct;
+  collectSplitDistinctMetadata(M, Partition, Distinct);
+
+  std::unique_ptr<TargetMachine> ThreadTM;
+  if (TM)
+    ThreadTM.reset(TM->getTarget().createTargetMachine(
+        TM->getTargetTriple().str(), TM->getTargetCPU(),
+        TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+        TM->getCodeModel(), TM->getOptLevel()));
+
+  PassBuilder PB(ThreadTM.get(), PTO);
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  FunctionPassManager FPM;
+  if (Error Err = BuildPipeline(PB, FPM))
+    return Err;
+  for (Function *F : Partition) {
+    PreservedAnalyses PA = FPM.run(*F, FAM);
+    FAM.invalidate(*F, PA);
+  }
+
+  NamedMDNode *NMD = M.getOrInsertNamedMetadata(SplitDistinctMDName);
+  for (MDNode *N : Distinct)
+    NMD->addOperand(N);
+
+  raw_svector_ostream OS(Result);
+  WriteBitcodeToFile(M, OS, /*ShouldPreserveUseListOrder=*/true);
+  return Error::success();
+}
+
+PreservedAnalyses
+ParallelModuleToFunctionPassAdaptor::run(Module &M,
+                                         ModuleAnalysisManager &AM) {
+  SplitModuleState Orig;
+  Orig.Globals.reserve(M.global_size());
+  for (GlobalVariable &GV : M.globals())
+    Orig.Globals.push_back(&GV);
+  for (GlobalAlias &GA : M.aliases())
+    Orig.IndirectSymbols.push_back(&GA);
+  for (GlobalIFunc &GI : M.ifuncs())
+    Orig.IndirectSymbols.push_back(&GI);
+
+  SmallPtrSet<const Function *, 4> BlockAddressFns;
+  findBlockAddressFunctions(M, BlockAddressFns);
+
+  std::vector<Function *> Definitions, Serial;
+  std::vector<unsigned> Parallel;
+  uint64_t TotalSize = 0;
+  for (Function &F : M) {
+    Orig.Functions.push_back(&F);
+    if (F.isDeclaration())
+      continue;
+    Definitions.push_back(&F);
+    if (BlockAddressFns.count(&F)) {
+      Serial.push_back(&F);
+      continue;
+    }
+    Parallel.push_back(Orig.Functions.size() - 1);
+    TotalSize += F.getInstructionCount();
+  }
+
+  unsigned NumThreads = std::min<size_t>(
+      hardware_concurrency(Threads).compute_thread_count(), Parallel.size());
+  if (NumThreads < 2)
+    return runFunctionPassInPlace(SerialPass, Definitions, M, AM);
+
+  // Split the functions into contiguous partitions of about the same number
+  // of instructions, one per thread.
+  std::vector<std::vector<unsigned>> Partitions(1);
+  uint64_t Size = 0;
+  for (unsigned Idx : Parallel) {
+    if (Size >= TotalSize * Partitions.size() / NumThreads &&
+        !Partitions.back().empty())
+      Partitions.emplace_back();
+    Partitions.back().push_back(Idx);
+    Size += cast<Function>(Orig.Functions[Idx])->getInstructionCount();
+  }
+
+  std::vector<std::vector<MDNode *>> OrigDistinct(Partitions.size());
+  for (unsigned P = 0; P != Partitions.size(); ++P) {
+    std::vector<Function *> Fns;
+    for (unsigned Idx : Partitions[P])
+      Fns.push_back(cast<Function>(Orig.Functions[Idx]));
+    collectSplitDistinctMetadata(M, Fns, OrigDistinct[P]);
+  }
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS, /*ShouldPreserveUseListOrder=*/true);
+  }
+  StringRef BitcodeRef(Bitcode.data(), Bitcode.size());
+  bool DiscardValueNames = M.getContext().shouldDiscardValueNames();
+
+  std::vector<SmallVector<char, 0>> Results(Partitions.size());
+  std::vector<std::string> Errors(Partitions.size());
+  PreservedAnalyses PA;
+  {
+    ThreadPool Pool(hardware_concurrency(NumThreads));
+    for (unsigned P = 0; P != Partitions.size(); ++P)
+      Pool.async([&, P] {
+        if (Error Err =
+                runPartition(BitcodeRef, Partitions[P], BuildPipeline, TM, PTO,
+                             DiscardValueNames, Results[P]))
+          Errors[P] = toString(std::move(Err));
+      });
+
+    // The module itself is free to be modified while the workers run.
+    PA = runFunctionPassInPlace(SerialPass, Serial, M, AM);
+    Pool.wait();
+  }
+
+  for (unsigned P = 0; P != Partitions.size(); ++P) {
+    if (!Errors[P].empty())
+      report_fatal_error("parallel-function: " + Errors[P]);
+    StringRef Result(Results[P].data(), Results[P].size());
+    if (Error Err =
+            mergeSplitModule(M, Result, Orig, Partitions[P], OrigDistinct[P]))
+      report_fatal_error("parallel-function: " + toString(std::move(Err)));
+  }
+
+  // The merged functions have new bodies and arguments, nothing on them is
+  // preserved.
+  return PreservedAnalyses::none();
+}
@@ -63,6 +63,8 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/SafepointIRVerifier.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Passes/CachingFunctionPassAdaptor.h"
+#include "llvm/Passes/ParallelFunctionPassAdaptor.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormatVariadic.h"
@@ -240,6 +242,16 @@ static cl::opt<bool> EnableSyntheticCounts(
     cl::desc("Run synthetic function entry count generation "
              "pass"));
 
+static cl::opt<std::string> FunctionCacheDir(
+    "function-cache-dir", cl::value_desc("directory"),
+    cl::desc("Directory cached-function(...) pipelines keep optimized "
+             "function bodies in"));
+
+static cl::opt<std::string> FunctionCachePolicy(
+    "function-cache-policy", cl::value_desc("policy"),
+    cl::desc("Pruning policy for the -function-cache-dir directory, in the "
+             "format of the ThinLTO cache policy"));
+
 static const Regex DefaultAliasRegex(
     "^(default|thinlto-pre-link|thinlto|lto-pre-link|lto)<(O[0123sz])>$");
 
@@ -1618,6 +1630,18 @@ static Optional<int> parseRepeatPassName(StringRef Name) {
   return Count;
 }
 
+static Optional<unsigned> parseParallelFunctionPassName(StringRef Name) {
+  if (!Name.consume_front("parallel-function"))
+    return None;
+  if (Name.empty())
+    return 0u;
+  unsigned Threads;
+  if (!Name.consume_front("<") || !Name.consume_back(">") ||
+      Name.getAsInteger(0, Threads) || Threads == 0)
+    return None;
+  return Threads;
+}
+
 static Optional<int> parseDevirtPassName(StringRef Name) {
   if (!Name.consume_front("devirt<") || !Name.consume_back(">"))
     return None;
@@ -1930,6 +1954,10 @@ static bool isModulePassName(StringRef Name, CallbacksT &Callbacks) {
   // Explicitly handle custom-parsed pass names.
   if (parseRepeatPassName(Name))
     return true;
+  if (parseParallelFunctionPassName(Name))
+    return true;
+  if (Name == "cached-function")
+    return true;
 
 #define MODULE_PASS(NAME, CREATE_PASS)                                         \
   if (Name == NAME)                                                            \
@@ -2074,6 +2102,21 @@ PassBuilder::parsePipelineText(StringRef Text) {
   return {std::move(ResultPipeline)};
 }
 
+/// Prints \p Pipeline in the textual format parsePipelineText() accepts.
+static void printPipeline(raw_ostream &OS,
+                          ArrayRef<PassBuilder::PipelineElement> Pipeline) {
+  for (const auto &E : Pipeline) {
+    if (&E != &Pipeline.front())
+      OS << ',';
+    OS << E.Name;
+    if (!E.InnerPipeline.empty()) {
+      OS << '(';
+      printPipeline(OS, E.InnerPipeline);
+      OS << ')';
+    }
+  }
+}
+
 Error PassBuilder::parseModulePass(ModulePassManager &MPM,
                                    const PipelineElement &E,
                                    bool VerifyEachPass, bool DebugLogging) {
@@ -2106,6 +2149,51 @@ Error PassBuilder::parseModulePass(ModulePassManager &MPM,
       MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
       return Error::success();
     }
+    if (auto Threads = parseParallelFunctionPassName(Name)) {
+      FunctionPassManager FPM(DebugLogging);
+      if (auto Err = parseFunctionPassPipeline(FPM, InnerPipeline,
+                                               VerifyEachPass, DebugLogging))
+        return Err;
+      // The worker threads parse the pipeline again with their own
+      // PassBuilder, so it has to outlive the text it was parsed from.
+      std::string Text;
+      raw_string_ostream OS(Text);
+      printPipeline(OS, InnerPipeline);
+      auto BuildPipeline = [Text = OS.str(), VerifyEachPass](
+                               PassBuilder &PB, FunctionPassManager &FPM) {
+        return PB.parsePassPipeline(FPM, Text, VerifyEachPass);
+      };
+      MPM.addPass(ParallelModuleToFunctionPassAdaptor(
+          std::move(FPM), std::move(BuildPipeline), TM, PTO, *Threads));
+      return Error::success();
+    }
+    if (Name == "cached-function") {
+      if (FunctionCacheDir.empty())
+        return make_error<StringError>(
+            "cached-function requires a cache directory, set with "
+            "-function-cache-dir",
+            inconvertibleErrorCode());
+      Expected<CachePruningPolicy> Policy =
+          parseCachePruningPolicy(FunctionCachePolicy);
+      if (!Policy)
+        return Policy.takeError();
+      FunctionPassManager FPM(DebugLogging);
+      if (auto Err = parseFunctionPassPipeline(FPM, InnerPipeline,
+                                               VerifyEachPass, DebugLogging))
+        return Err;
+      // The pipeline text is also part of the cache key.
+      std::string Text;
+      raw_string_ostream OS(Text);
+      printPipeline(OS, InnerPipeline);
+      auto BuildPipeline = [Text = OS.str(), VerifyEachPass](
+                               PassBuilder &PB, FunctionPassManager &FPM) {
+        return PB.parsePassPipeline(FPM, Text, VerifyEachPass);
+      };
+      MPM.addPass(CachingModuleToFunctionPassAdaptor(
+          std::move(FPM), std::move(BuildPipeline), OS.str(), FunctionCacheDir,
+          TM, PTO, *Policy));
+      return Error::success();
+    }
     if (auto Count = parseRepeatPassName(Name)) {
       ModulePassManager NestedMPM(DebugLogging);
       if (auto Err = parseModulePassPipeline(NestedMPM, InnerPipeline,
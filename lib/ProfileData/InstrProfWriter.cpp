@@ -141,7 +141,17 @@ public:
     using namespace support;
 
     endian::Writer LE(Out, little);
-    for (const auto &ProfileData : *V) {
+    // Write the records by function hash, rather than in the order they were
+    // added to the map.
+    using RecordType = InstrProfWriter::ProfilingData::value_type;
+    SmallVector<const RecordType *, 4> OrderedData;
+    for (const auto &ProfileData : *V)
+      OrderedData.push_back(&ProfileData);
+    llvm::sort(OrderedData, [](const RecordType *A, const RecordType *B) {
+      return A->first < B->first;
+    });
+    for (const RecordType *Data : OrderedData) {
+      const auto &ProfileData = *Data;
       const InstrProfRecord &ProfRecord = ProfileData.second;
       if (NamedInstrProfRecord::hasCSFlagInHash(ProfileData.first))
         CSSummaryBuilder->addRecord(ProfRecord);
@@ -294,10 +304,19 @@ void InstrProfWriter::writeImpl(ProfOStream &OS) {
   InstrProfSummaryBuilder CSISB(ProfileSummaryBuilder::DefaultCutoffs);
   InfoObj->CSSummaryBuilder = &CSISB;
 
-  // Populate the hash table generator.
+  // Populate the hash table generator. The order of the entries in a bucket
+  // is the order they were inserted in, so insert them by name, which makes
+  // the output independent of how the records were added and merged.
+  std::vector<const StringMapEntry<ProfilingData> *> OrderedFuncData;
   for (const auto &I : FunctionData)
     if (shouldEncodeData(I.getValue()))
-      Generator.insert(I.getKey(), &I.getValue());
+      OrderedFuncData.push_back(&I);
+  llvm::sort(OrderedFuncData, [](const StringMapEntry<ProfilingData> *A,
+                                 const StringMapEntry<ProfilingData> *B) {
+    return A->getKey() < B->getKey();
+  });
+  for (const StringMapEntry<ProfilingData> *I : OrderedFuncData)
+    Generator.insert(I->getKey(), &I->getValue());
   // Write the header.
   IndexedInstrProf::Header Header;
   Header.Magic = IndexedInstrProf::Magic;
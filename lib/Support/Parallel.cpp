@@ -12,8 +12,8 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
+#include <deque>
 #include <future>
-#include <stack>
 #include <thread>
 #include <vector>
 
@@ -31,17 +31,39 @@ namespace {
 class Executor {
 public:
   virtual ~Executor() = default;
-  virtual void add(std::function<void()> func) = 0;
+  virtual void add(std::function<void()> func,
+                   TaskPriority Priority = TaskPriority::Normal) = 0;
+
+  /// Runs one pending task on the calling thread if the calling thread is a
+  /// worker of this executor and there is a task to run. Returns false if no
+  /// task was run.
+  virtual bool runPendingTask() = 0;
+
+  /// Blocks the calling worker until \p L is done or a task is added.
+  virtual void waitForTask(const Latch &L) = 0;
 
   static Executor *getDefaultExecutor();
 };
 
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+/// Index of the current thread in the default executor's worker list, or -1
+/// if the current thread is not a worker.
+static LLVM_THREAD_LOCAL int CurrentWorker = -1;
+
+/// An implementation of an Executor that runs closures on a thread pool using
+/// work stealing. Each worker owns a deque which it pushes to and pops from in
+/// lifo order; idle workers steal the oldest task from other workers' deques,
+/// which for divide-and-conquer algorithms such as parallel_quick_sort are the
+/// largest pieces of work. Tasks added from outside the pool are distributed
+/// round-robin across the deques. High priority tasks go to a shared fifo queue
+/// that every worker checks first.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(ThreadPoolStrategy S = hardware_concurrency()) {
     unsigned ThreadCount = S.compute_thread_count();
+    WaitingOn.resize(ThreadCount);
+    Queues.reserve(ThreadCount);
+    for (unsigned I = 0; I < ThreadCount; ++I)
+      Queues.push_back(std::make_unique<WorkQueue>());
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     Threads.reserve(ThreadCount);
@@ -86,31 +108,128 @@ public:
     static void call(void *Ptr) { ((ThreadPoolExecutor *)Ptr)->stop(); }
   };
 
-  void add(std::function<void()> F) override {
+  void add(std::function<void()> F, TaskPriority Priority) override {
+    // Count the task before publishing it so that PendingTasks never drops
+    // below the number of queued tasks.
+    ++PendingTasks;
+    if (Priority == TaskPriority::High) {
+      std::lock_guard<std::mutex> Lock(HighPriorityQueue.Mutex);
+      HighPriorityQueue.Tasks.push_back(std::move(F));
+    } else {
+      // Workers push onto their own deque so that the tasks they spawn stay
+      // local; other threads spread their tasks across all workers.
+      unsigned Index = CurrentWorker >= 0
+                           ? CurrentWorker
+                           : NextQueue.fetch_add(1, std::memory_order_relaxed) %
+                                 Queues.size();
+      WorkQueue &Q = *Queues[Index];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      Q.Tasks.push_back(std::move(F));
+    }
+    // Only take the lock if a worker may be asleep. Sleeping workers register
+    // themselves before checking PendingTasks, so either they see the new task
+    // or we see them and wake them up.
+    if (Sleepers != 0) {
+      { std::lock_guard<std::mutex> Lock(Mutex); }
+      Cond.notify_one();
+    }
+    // The same goes for workers waiting for a TaskGroup, which wait on the
+    // group's latch.
+    if (Waiters != 0) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      for (const Latch *L : WaitingOn)
+        if (L)
+          L->notify();
+    }
+  }
+
+  bool runPendingTask() override {
+    if (CurrentWorker < 0)
+      return false;
+    std::function<void()> Task;
+    if (!takeTask(CurrentWorker, Task))
+      return false;
+    Task();
+    return true;
+  }
+
+  void waitForTask(const Latch &L) override {
+    assert(CurrentWorker >= 0 && "Only workers wait for tasks");
     {
       std::lock_guard<std::mutex> Lock(Mutex);
-      WorkStack.push(F);
+      WaitingOn[CurrentWorker] = &L;
     }
-    Cond.notify_one();
+    ++Waiters;
+    L.syncOr([&] { return PendingTasks != 0; });
+    --Waiters;
+    std::lock_guard<std::mutex> Lock(Mutex);
+    WaitingOn[CurrentWorker] = nullptr;
   }
 
 private:
+  struct WorkQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  /// Takes a task, looking first at the high priority queue, then at the back
+  /// of the worker's own deque and finally at the front of the other workers'
+  /// deques.
+  bool takeTask(unsigned ThreadID, std::function<void()> &Task) {
+    if (PendingTasks == 0)
+      return false;
+    auto TakeFront = [&](WorkQueue &Q) {
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (Q.Tasks.empty())
+        return false;
+      Task = std::move(Q.Tasks.front());
+      Q.Tasks.pop_front();
+      return true;
+    };
+    bool Found = TakeFront(HighPriorityQueue);
+    if (!Found) {
+      WorkQueue &Own = *Queues[ThreadID];
+      std::lock_guard<std::mutex> Lock(Own.Mutex);
+      if (!Own.Tasks.empty()) {
+        Task = std::move(Own.Tasks.back());
+        Own.Tasks.pop_back();
+        Found = true;
+      }
+    }
+    for (size_t I = 1, E = Queues.size(); !Found && I < E; ++I)
+      Found = TakeFront(*Queues[(ThreadID + I) % E]);
+    if (Found)
+      --PendingTasks;
+    return Found;
+  }
+
   void work(ThreadPoolStrategy S, unsigned ThreadID) {
     S.apply_thread_strategy(ThreadID);
+    CurrentWorker = ThreadID;
     while (true) {
+      std::function<void()> Task;
+      if (takeTask(ThreadID, Task)) {
+        Task();
+        continue;
+      }
       std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
+      ++Sleepers;
+      Cond.wait(Lock, [&] { return Stop || PendingTasks != 0; });
+      --Sleepers;
       if (Stop)
         break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
-      Lock.unlock();
-      Task();
     }
   }
 
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
+  std::atomic<size_t> PendingTasks{0};
+  std::atomic<unsigned> Sleepers{0};
+  std::atomic<unsigned> Waiters{0};
+  std::atomic<unsigned> NextQueue{0};
+  std::vector<std::unique_ptr<WorkQueue>> Queues;
+  /// The latch each worker waits on in TaskGroup::sync, if any.
+  std::vector<const Latch *> WaitingOn;
+  WorkQueue HighPriorityQueue;
   std::mutex Mutex;
   std::condition_variable Cond;
   std::promise<void> ThreadsCreated;
@@ -144,25 +263,32 @@ Executor *Executor::getDefaultExecutor() {
 }
 } // namespace
 
-static std::atomic<int> TaskGroupInstances;
-
-// Latch::sync() called by the dtor may cause one thread to block. If is a dead
-// lock if all threads in the default executor are blocked. To prevent the dead
-// lock, only allow the first TaskGroup to run tasks parallelly. In the scenario
-// of nested parallel_for_each(), only the outermost one runs parallelly.
-TaskGroup::TaskGroup() : Parallel(TaskGroupInstances++ == 0) {}
-TaskGroup::~TaskGroup() { --TaskGroupInstances; }
-
-void TaskGroup::spawn(std::function<void()> F) {
-  if (Parallel) {
-    L.inc();
-    Executor::getDefaultExecutor()->add([&, F] {
-      F();
-      L.dec();
-    });
-  } else {
-    F();
+TaskGroup::~TaskGroup() { sync(); }
+
+void TaskGroup::spawn(std::function<void()> F, TaskPriority Priority) {
+  L.inc();
+  Executor::getDefaultExecutor()->add(
+      [&, F] {
+        F();
+        L.dec();
+      },
+      Priority);
+}
+
+void TaskGroup::sync() const {
+  // A worker thread must not block here: the tasks it is waiting for may be
+  // queued behind it, and with nested TaskGroups every worker could end up
+  // waiting. Run other pending tasks until the group has finished instead, and
+  // sleep while there are none, e.g. because the last tasks of the group run on
+  // other workers.
+  if (CurrentWorker < 0) {
+    L.sync();
+    return;
   }
+  Executor *E = Executor::getDefaultExecutor();
+  while (!L.isDone())
+    if (!E->runPendingTask())
+      E->waitForTask(L);
 }
 
 } // namespace detail
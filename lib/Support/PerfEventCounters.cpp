@@ -0,0 +1,101 @@
+//===- PerfEventCounters.cpp - Hardware event counters --------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/PerfEventCounters.h"
+#include "llvm/Support/ErrorHandling.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+#ifdef __linux__
+static int openCounter(uint64_t Config, int GroupFD) {
+  perf_event_attr Attr;
+  std::memset(&Attr, 0, sizeof(Attr));
+  Attr.size = sizeof(Attr);
+  Attr.type = PERF_TYPE_HARDWARE;
+  Attr.config = Config;
+  Attr.exclude_kernel = 1;
+  Attr.exclude_hv = 1;
+  Attr.read_format = PERF_FORMAT_GROUP;
+  // Count the calling thread, on any CPU.
+  return syscall(__NR_perf_event_open, &Attr, /*pid=*/0, /*cpu=*/-1, GroupFD,
+                 /*flags=*/0);
+}
+#endif
+
+PerfEventCounters::PerfEventCounters() {
+  FDs.fill(-1);
+#ifdef __linux__
+  static const uint64_t Configs[NumEventKinds] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  FDs[Cycles] = openCounter(Configs[Cycles], -1);
+  if (FDs[Cycles] == -1)
+    return;
+  for (unsigned Kind = Cycles + 1; Kind != NumEventKinds; ++Kind)
+    FDs[Kind] = openCounter(Configs[Kind], FDs[Cycles]);
+#endif
+}
+
+PerfEventCounters::~PerfEventCounters() {
+#ifdef __linux__
+  // Close the group leader last.
+  for (unsigned Kind = NumEventKinds; Kind-- != 0;)
+    if (FDs[Kind] != -1)
+      close(FDs[Kind]);
+#endif
+}
+
+PerfEventCounters::Values PerfEventCounters::read() const {
+  Values Counts;
+  Counts.fill(0);
+#ifdef __linux__
+  if (!isValid())
+    return Counts;
+
+  // With PERF_FORMAT_GROUP, the leader reads { nr, value[nr] } for the
+  // whole group.
+  uint64_t Buffer[1 + NumEventKinds];
+  ssize_t Size = ::read(FDs[Cycles], Buffer, sizeof(Buffer));
+  if (Size < ssize_t(sizeof(uint64_t)))
+    return Counts;
+  uint64_t NumValues =
+      std::min<uint64_t>(Buffer[0], Size / sizeof(uint64_t) - 1);
+
+  // The values are in the order in which the counters were opened, which
+  // skips the ones that failed to open.
+  uint64_t Value = 0;
+  for (unsigned Kind = 0; Kind != NumEventKinds && Value != NumValues; ++Kind)
+    if (FDs[Kind] != -1)
+      Counts[Kind] = Buffer[1 + Value++];
+#endif
+  return Counts;
+}
+
+StringRef PerfEventCounters::getEventName(EventKind Kind) {
+  switch (Kind) {
+  case Cycles:
+    return "Cycles";
+  case Instructions:
+    return "Instructions";
+  case CacheMisses:
+    return "Cache misses";
+  case BranchMisses:
+    return "Branch misses";
+  case NumEventKinds:
+    break;
+  }
+  llvm_unreachable("Invalid event kind");
+}
@@ -11,12 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/JSON.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cassert>
@@ -47,13 +50,14 @@ typedef std::pair<std::string, CountAndDurationType>
 
 namespace {
 struct Entry {
-  const TimePointType Start;
+  TimePointType Start;
   TimePointType End;
-  const std::string Name;
-  const std::string Detail;
+  // Interned by the profiler, so names can be compared by pointer.
+  StringRef Name;
+  std::string Detail;
 
-  Entry(TimePointType &&S, TimePointType &&E, std::string &&N, std::string &&Dt)
-      : Start(std::move(S)), End(std::move(E)), Name(std::move(N)),
+  Entry(TimePointType &&S, TimePointType &&E, StringRef N, std::string &&Dt)
+      : Start(std::move(S)), End(std::move(E)), Name(N),
         Detail(std::move(Dt)) {}
 
   // Calculate timings for FlameGraph. Cast time points to microsecond precision
@@ -74,19 +78,33 @@ struct Entry {
 } // namespace
 
 struct llvm::TimeTraceProfiler {
-  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "")
+  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "",
+                    unsigned MaxEntries = 0, unsigned SampleInterval = 1)
       : BeginningOfTime(system_clock::now()), StartTime(steady_clock::now()),
         ProcName(ProcName), Pid(sys::Process::getProcessId()),
-        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity) {
+        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity),
+        MaxEntries(MaxEntries), SampleInterval(SampleInterval) {
     llvm::get_thread_name(ThreadName);
   }
 
-  void begin(std::string Name, llvm::function_ref<std::string()> Detail) {
-    Stack.emplace_back(steady_clock::now(), TimePointType(), std::move(Name),
+  void begin(StringRef Name, llvm::function_ref<std::string()> Detail) {
+    // Skip the sections nested in an outermost section that is not sampled,
+    // and all but one in every SampleInterval outermost sections.
+    if (UnsampledDepth ||
+        (Stack.empty() && SampleInterval > 1 &&
+         OutermostSections++ % SampleInterval != 0)) {
+      ++UnsampledDepth;
+      return;
+    }
+    Stack.emplace_back(steady_clock::now(), TimePointType(), Names.save(Name),
                        Detail());
   }
 
   void end() {
+    if (UnsampledDepth) {
+      --UnsampledDepth;
+      return;
+    }
     assert(!Stack.empty() && "Must call begin() first");
     Entry &E = Stack.back();
     E.End = steady_clock::now();
@@ -94,33 +112,52 @@ struct llvm::TimeTraceProfiler {
     // Check that end times monotonically increase.
     assert((Entries.empty() ||
             (E.getFlameGraphStartUs(StartTime) + E.getFlameGraphDurUs() >=
-             Entries.back().getFlameGraphStartUs(StartTime) +
-                 Entries.back().getFlameGraphDurUs())) &&
+             lastEntry().getFlameGraphStartUs(StartTime) +
+                 lastEntry().getFlameGraphDurUs())) &&
            "TimeProfiler scope ended earlier than previous scope");
 
     // Calculate duration at full precision for overall counts.
     DurationType Duration = E.End - E.Start;
 
-    // Only include sections longer or equal to TimeTraceGranularity msec.
-    if (duration_cast<microseconds>(Duration).count() >= TimeTraceGranularity)
-      Entries.emplace_back(E);
-
     // Track total time taken by each "name", but only the topmost levels of
     // them; e.g. if there's a template instantiation that instantiates other
     // templates from within, we only want to add the topmost one. "topmost"
     // happens to be the ones that don't have any currently open entries above
     // itself.
     if (std::find_if(++Stack.rbegin(), Stack.rend(), [&](const Entry &Val) {
-          return Val.Name == E.Name;
+          return Val.Name.data() == E.Name.data();
         }) == Stack.rend()) {
-      auto &CountAndTotal = CountAndTotalPerName[E.Name];
+      auto &CountAndTotal = CountAndTotalPerName[E.Name.data()];
       CountAndTotal.first++;
       CountAndTotal.second += Duration;
     }
 
+    // Only include sections longer or equal to TimeTraceGranularity msec.
+    // Once MaxEntries are recorded, overwrite the oldest one.
+    if (duration_cast<microseconds>(Duration).count() >= TimeTraceGranularity) {
+      if (!MaxEntries || Entries.size() < MaxEntries) {
+        Entries.push_back(std::move(E));
+      } else {
+        Entries[OldestEntry] = std::move(E);
+        OldestEntry = (OldestEntry + 1) % MaxEntries;
+      }
+    }
+
     Stack.pop_back();
   }
 
+  const Entry &lastEntry() const {
+    return Entries[(OldestEntry + Entries.size() - 1) % Entries.size()];
+  }
+
+  /// Call \p Fn on the recorded entries, in the order in which they ended.
+  template <typename FnT> void forEachEntry(FnT Fn) const {
+    for (size_t I = OldestEntry, E = Entries.size(); I != E; ++I)
+      Fn(Entries[I]);
+    for (size_t I = 0; I != OldestEntry; ++I)
+      Fn(Entries[I]);
+  }
+
   // Write events from this TimeTraceProfilerInstance and
   // ThreadTimeTraceProfilerInstances.
   void write(raw_pwrite_stream &OS) {
@@ -154,11 +191,9 @@ struct llvm::TimeTraceProfiler {
         }
       });
     };
-    for (const Entry &E : Entries)
-      writeEvent(E, this->Tid);
+    forEachEntry([&](const Entry &E) { writeEvent(E, this->Tid); });
     for (const TimeTraceProfiler *TTP : ThreadTimeTraceProfilerInstances)
-      for (const Entry &E : TTP->Entries)
-        writeEvent(E, TTP->Tid);
+      TTP->forEachEntry([&](const Entry &E) { writeEvent(E, TTP->Tid); });
 
     // Emit totals by section name as additional "thread" events, sorted from
     // longest one.
@@ -170,8 +205,8 @@ struct llvm::TimeTraceProfiler {
     // Combine all CountAndTotalPerName from threads into one.
     StringMap<CountAndDurationType> AllCountAndTotalPerName;
     auto combineStat = [&](const auto &Stat) {
-      StringRef Key = Stat.getKey();
-      auto Value = Stat.getValue();
+      StringRef Key = Stat.first;
+      auto Value = Stat.second;
       auto &CountAndTotal = AllCountAndTotalPerName[Key];
       CountAndTotal.first += Value.first;
       CountAndTotal.second += Value.second;
@@ -248,7 +283,12 @@ struct llvm::TimeTraceProfiler {
 
   SmallVector<Entry, 16> Stack;
   SmallVector<Entry, 128> Entries;
-  StringMap<CountAndDurationType> CountAndTotalPerName;
+  // The index in Entries of the oldest entry, once MaxEntries are recorded.
+  size_t OldestEntry = 0;
+  // Keyed by the interned names, which are null-terminated.
+  DenseMap<const char *, CountAndDurationType> CountAndTotalPerName;
+  BumpPtrAllocator Alloc;
+  UniqueStringSaver Names{Alloc};
   const time_point<system_clock> BeginningOfTime;
   const TimePointType StartTime;
   const std::string ProcName;
@@ -258,20 +298,32 @@ struct llvm::TimeTraceProfiler {
 
   // Minimum time granularity (in microseconds)
   const unsigned TimeTraceGranularity;
+
+  // Maximum number of entries to keep, or 0 to keep all of them.
+  const unsigned MaxEntries;
+
+  // Only one in every SampleInterval outermost sections is recorded.
+  const unsigned SampleInterval;
+  unsigned OutermostSections = 0;
+  // The nesting depth of the current section that is not recorded, if any.
+  unsigned UnsampledDepth = 0;
 };
 
 void llvm::timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
-                                       StringRef ProcName) {
+                                       StringRef ProcName, unsigned MaxEntries,
+                                       unsigned SampleInterval) {
   assert(TimeTraceProfilerInstance == nullptr &&
          "Profiler should not be initialized");
   TimeTraceProfilerInstance = new TimeTraceProfiler(
-      TimeTraceGranularity, llvm::sys::path::filename(ProcName));
+      TimeTraceGranularity, llvm::sys::path::filename(ProcName), MaxEntries,
+      SampleInterval);
 }
 
 // Removes all TimeTraceProfilerInstances.
 // Called from main thread.
 void llvm::timeTraceProfilerCleanup() {
   delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
   std::lock_guard<std::mutex> Lock(Mu);
   for (auto TTP : ThreadTimeTraceProfilerInstances)
     delete TTP;
@@ -314,14 +366,14 @@ Error llvm::timeTraceProfilerWrite(StringRef PreferredFileName,
 
 void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
   if (TimeTraceProfilerInstance != nullptr)
-    TimeTraceProfilerInstance->begin(std::string(Name),
+    TimeTraceProfilerInstance->begin(Name,
                                      [&]() { return std::string(Detail); });
 }
 
 void llvm::timeTraceProfilerBegin(StringRef Name,
                                   llvm::function_ref<std::string()> Detail) {
   if (TimeTraceProfilerInstance != nullptr)
-    TimeTraceProfilerInstance->begin(std::string(Name), Detail);
+    TimeTraceProfilerInstance->begin(Name, Detail);
 }
 
 void llvm::timeTraceProfilerEnd() {
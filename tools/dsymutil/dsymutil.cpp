@@ -36,6 +36,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ThreadPool.h"
@@ -591,6 +592,12 @@ int main(int argc, char **argv) {
     }
     ThreadPool Threads(S);
 
+    // The links parse the debug info of their objects on the shared
+    // llvm::parallel executor. Size it from --num-threads, so that the links
+    // running at the same time share those threads instead of each creating
+    // their own.
+    parallel::strategy = hardware_concurrency(Options.LinkOpts.Threads);
+
     // If there is more than one link to execute, we need to generate
     // temporary files.
     const bool NeedsTempFiles =
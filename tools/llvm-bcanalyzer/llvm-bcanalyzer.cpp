@@ -69,9 +69,11 @@ static Error reportError(StringRef Message) {
 }
 
 static Expected<std::unique_ptr<MemoryBuffer>> openBitcodeFile(StringRef Path) {
-  // Read the input file.
+  // Read the input file. Bitcode doesn't need a null terminator, which lets
+  // the file be mapped rather than read.
   Expected<std::unique_ptr<MemoryBuffer>> MemBufOrErr =
-      errorOrToExpected(MemoryBuffer::getFileOrSTDIN(Path));
+      errorOrToExpected(MemoryBuffer::getFileOrSTDIN(
+          Path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false));
   if (Error E = MemBufOrErr.takeError())
     return std::move(E);
 
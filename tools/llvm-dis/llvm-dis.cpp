@@ -151,13 +151,18 @@ int main(int argc, char **argv) {
 
   ExitOnErr.setBanner(std::string(argv[0]) + ": error: ");
 
+  // The buffer outlives the context, so that metadata strings can refer to it
+  // rather than being copied. The bitcode reader doesn't need a null
+  // terminator, which lets the file be mapped rather than read.
+  std::unique_ptr<MemoryBuffer> MB;
   LLVMContext Context;
+  Context.setBitcodeOutlivesContext(true);
   Context.setDiagnosticHandler(
       std::make_unique<LLVMDisDiagnosticHandler>(argv[0]));
   cl::ParseCommandLineOptions(argc, argv, "llvm .bc -> .ll disassembler\n");
 
-  std::unique_ptr<MemoryBuffer> MB =
-      ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFilename)));
+  MB = ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(
+      InputFilename, /*FileSize=*/-1, /*RequiresNullTerminator=*/false)));
 
   BitcodeFileContents IF = ExitOnErr(llvm::getBitcodeFileContents(*MB));
 
@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm-dwarfdump.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Triple.h"
@@ -27,6 +28,8 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
@@ -182,6 +185,12 @@ static opt<uint64_t>
            desc("Lookup <address> in the debug information and print out any "
                 "available file, function, block and line table details."),
            value_desc("address"), cat(DwarfDumpCategory));
+static opt<unsigned>
+    NumThreads("num-threads",
+               desc("Number of threads used to index the debug information "
+                    "for -name and -lookup (default = 1). 0 uses all "
+                    "available hardware threads."),
+               init(1), value_desc("N"), cat(DwarfDumpCategory));
 static opt<std::string>
     OutputFilename("o", cl::init("-"),
                    cl::desc("Redirect output to the specified file."),
@@ -314,13 +323,31 @@ using HandlerFn = std::function<bool(ObjectFile &, DWARFContext &DICtx,
                                      const Twine &, raw_ostream &)>;
 
 /// Print only DIEs that have a certain name.
-static bool filterByName(const StringSet<> &Names, DWARFDie Die,
-                         StringRef NameRef, raw_ostream &OS) {
-  DIDumpOptions DumpOpts = getDumpOpts(Die.getDwarfUnit()->getContext());
-  std::string Name =
-      (IgnoreCase && !UseRegex) ? NameRef.lower() : NameRef.str();
+static void filterByName(DWARFContext::unit_iterator_range CUs,
+                         const DenseSet<const DWARFDebugInfoEntry *> &Matches,
+                         raw_ostream &OS) {
+  for (const auto &CU : CUs)
+    for (const auto &Entry : CU->dies())
+      if (Matches.count(&Entry)) {
+        DWARFDie Die = {CU.get(), &Entry};
+        Die.dump(OS, 0, getDumpOpts(CU->getContext()));
+      }
+}
+
+/// Print only DIEs that have a certain name. The matching DIEs are found in
+/// the name index of \p DICtx and printed in the order of the units.
+static void filterByName(const StringSet<> &Names, DWARFContext &DICtx,
+                         ThreadPool *Pool, raw_ostream &OS) {
+  const DWARFContext::DIENameIndex &Index = DICtx.getDIENameIndex(Pool);
+  DenseSet<const DWARFDebugInfoEntry *> Matches;
+  auto AddMatches = [&](const SmallVectorImpl<DWARFDie> &Dies) {
+    for (DWARFDie Die : Dies)
+      Matches.insert(Die.getDebugInfoEntry());
+  };
+
   if (UseRegex) {
     // Match regular expression.
+    std::vector<Regex> Patterns;
     for (auto Pattern : Names.keys()) {
       Regex RE(Pattern, IgnoreCase ? Regex::IgnoreCase : Regex::NoFlags);
       std::string Error;
@@ -328,32 +355,29 @@ static bool filterByName(const StringSet<> &Names, DWARFDie Die,
         errs() << "error in regular expression: " << Error << "\n";
         exit(1);
       }
-      if (RE.match(Name)) {
-        Die.dump(OS, 0, DumpOpts);
-        return true;
-      }
+      Patterns.push_back(std::move(RE));
     }
-  } else if (Names.count(Name)) {
+    for (const auto &Entry : Index)
+      if (llvm::any_of(Patterns,
+                       [&](Regex &RE) { return RE.match(Entry.getKey()); }))
+        AddMatches(Entry.getValue());
+  } else if (IgnoreCase) {
+    for (const auto &Entry : Index)
+      if (Names.count(Entry.getKey().lower()))
+        AddMatches(Entry.getValue());
+  } else {
     // Match full text.
-    Die.dump(OS, 0, DumpOpts);
-    return true;
+    for (const auto &Name : Names.keys()) {
+      auto It = Index.find(Name);
+      if (It != Index.end())
+        AddMatches(It->getValue());
+    }
   }
-  return false;
-}
 
-/// Print only DIEs that have a certain name.
-static void filterByName(const StringSet<> &Names,
-                         DWARFContext::unit_iterator_range CUs,
-                         raw_ostream &OS) {
-  for (const auto &CU : CUs)
-    for (const auto &Entry : CU->dies()) {
-      DWARFDie Die = {CU.get(), &Entry};
-      if (const char *Name = Die.getName(DINameKind::ShortName))
-        if (filterByName(Names, Die, Name, OS))
-          continue;
-      if (const char *Name = Die.getName(DINameKind::LinkageName))
-        filterByName(Names, Die, Name, OS);
-    }
+  if (Matches.empty())
+    return;
+  filterByName(DICtx.normal_units(), Matches, OS);
+  filterByName(DICtx.dwo_units(), Matches, OS);
 }
 
 static void getDies(DWARFContext &DICtx, const AppleAcceleratorTable &Accel,
@@ -420,7 +444,10 @@ static void filterByAccelName(ArrayRef<std::string> Names, DWARFContext &DICtx,
 /// need to do something with this: extend lookup option with section
 /// information or probably display all matched entries, or something else...
 static bool lookup(ObjectFile &Obj, DWARFContext &DICtx, uint64_t Address,
-                   raw_ostream &OS) {
+                   ThreadPool *Pool, raw_ostream &OS) {
+  // Build the address map up front, so that the units not described by
+  // .debug_aranges are indexed concurrently.
+  DICtx.getDebugAranges(Pool);
   auto DIEsForAddr = DICtx.getDIEsForAddress(Lookup);
 
   if (!DIEsForAddr)
@@ -452,9 +479,15 @@ static bool dumpObjectFile(ObjectFile &Obj, DWARFContext &DICtx,
   if (!(DumpType & DIDT_UUID) || DumpType == DIDT_All)
     OS << Filename << ":\tfile format " << Obj.getFileFormatName() << '\n';
 
+  // The --lookup and --name options index all of the units, which is done
+  // concurrently unless a single thread was requested.
+  std::unique_ptr<ThreadPool> Pool;
+  if ((Lookup || !Name.empty()) && NumThreads != 1)
+    Pool = std::make_unique<ThreadPool>(hardware_concurrency(NumThreads));
+
   // Handle the --lookup option.
   if (Lookup)
-    return lookup(Obj, DICtx, Lookup, OS);
+    return lookup(Obj, DICtx, Lookup, Pool.get(), OS);
 
   // Handle the --name option.
   if (!Name.empty()) {
@@ -462,8 +495,7 @@ static bool dumpObjectFile(ObjectFile &Obj, DWARFContext &DICtx,
     for (auto name : Name)
       Names.insert((IgnoreCase && !UseRegex) ? StringRef(name).lower() : name);
 
-    filterByName(Names, DICtx.normal_units(), OS);
-    filterByName(Names, DICtx.dwo_units(), OS);
+    filterByName(Names, DICtx, Pool.get(), OS);
     return true;
   }
 
@@ -25,6 +25,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
@@ -139,13 +140,27 @@ static cl::opt<bool> PreserveAssemblyUseListOrder(
 int main(int argc, char **argv) {
   InitLLVM X(argc, argv);
 
+  // The input outlives the context, so that metadata strings can refer to it
+  // rather than being copied.
+  std::unique_ptr<MemoryBuffer> Input;
   LLVMContext Context;
+  Context.setBitcodeOutlivesContext(true);
   cl::HideUnrelatedOptions(ExtractCat);
   cl::ParseCommandLineOptions(argc, argv, "llvm extractor\n");
 
-  // Use lazy loading, since we only care about selected global values.
   SMDiagnostic Err;
-  std::unique_ptr<Module> M = getLazyIRFileModule(InputFilename, Err, Context);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> InputOrErr =
+      MemoryBuffer::getFileOrSTDIN(InputFilename);
+  if (std::error_code EC = InputOrErr.getError()) {
+    errs() << argv[0] << ": could not open input file '" << InputFilename
+           << "': " << EC.message() << '\n';
+    return 1;
+  }
+  Input = std::move(*InputOrErr);
+
+  // Use lazy loading, since we only care about selected global values.
+  std::unique_ptr<Module> M = getLazyIRModule(
+      MemoryBuffer::getMemBuffer(Input->getMemBufferRef()), Err, Context);
 
   if (!M.get()) {
     Err.print(argv[0], errs());
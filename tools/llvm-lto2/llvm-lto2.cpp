@@ -53,6 +53,15 @@ static cl::opt<std::string> OutputFilename("o", cl::Required,
 static cl::opt<std::string> CacheDir("cache-dir", cl::desc("Cache Directory"),
                                      cl::value_desc("directory"));
 
+static cl::opt<bool> CacheImportedContent(
+    "thinlto-cache-imported-content",
+    cl::desc("Key ThinLTO cache entries on the imported content rather than "
+             "on the whole of the modules imported from"));
+
+static cl::opt<bool> RegularLTOLazyMetadata(
+    "regular-lto-lazy-metadata",
+    cl::desc("Load the metadata of regular LTO modules on-demand"));
+
 static cl::opt<std::string> OptPipeline("opt-pipeline",
                                         cl::desc("Optimizer Pipeline"),
                                         cl::value_desc("pipeline"));
@@ -284,6 +293,8 @@ static int run(int argc, char **argv) {
   Conf.OverrideTriple = OverrideTriple;
   Conf.DefaultTriple = DefaultTriple;
   Conf.StatsFile = StatsFile;
+  Conf.ThinLTOCacheImportedContent = CacheImportedContent;
+  Conf.RegularLTOLazyMetadata = RegularLTOLazyMetadata;
   Conf.PTO.LoopVectorization = Conf.OptLevel > 1;
   Conf.PTO.SLPVectorization = Conf.OptLevel > 1;
 
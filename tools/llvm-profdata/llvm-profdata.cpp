@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -221,10 +222,14 @@ static void overlapInput(const std::string &BaseFilename,
   }
 }
 
-/// Load an input into a writer context.
+/// Load an input into the writer contexts \p Shards. When there is more than
+/// one shard, each function record is added to the shard selected by the hash
+/// of its name, so that every function is held in memory only once no matter
+/// how many inputs are loaded concurrently. Errors about the input as a whole
+/// are recorded in the first shard.
 static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
-                      WriterContext *WC) {
-  std::unique_lock<std::mutex> CtxGuard{WC->Lock};
+                      ArrayRef<WriterContext *> Shards) {
+  WriterContext *WC = Shards.front();
 
   // Copy the filename, because llvm::ThreadPool copied the input "const
   // WeightedFile &" by value, making a reference to the filename within it
@@ -235,15 +240,30 @@ static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
   if (Error E = ReaderOrErr.takeError()) {
     // Skip the empty profiles by returning sliently.
     instrprof_error IPE = InstrProfError::take(std::move(E));
-    if (IPE != instrprof_error::empty_raw_profile)
+    if (IPE != instrprof_error::empty_raw_profile) {
+      std::unique_lock<std::mutex> CtxGuard{WC->Lock};
       WC->Errors.emplace_back(make_error<InstrProfError>(IPE), Filename);
+    }
     return;
   }
 
   auto Reader = std::move(ReaderOrErr.get());
   bool IsIRProfile = Reader->isIRLevelProfile();
   bool HasCSIRProfile = Reader->hasCSIRLevelProfile();
-  if (WC->Writer.setIsIRLevelProfile(IsIRProfile, HasCSIRProfile)) {
+  // Update the profile kind of all shards atomically, so that concurrently
+  // loaded inputs are seen in the same order by every shard.
+  bool KindMismatch = false;
+  std::vector<std::unique_lock<std::mutex>> ShardGuards;
+  for (WriterContext *Shard : Shards)
+    ShardGuards.emplace_back(Shard->Lock);
+  for (WriterContext *Shard : Shards) {
+    if (Error E = Shard->Writer.setIsIRLevelProfile(IsIRProfile,
+                                                    HasCSIRProfile)) {
+      consumeError(std::move(E));
+      KindMismatch = true;
+    }
+  }
+  if (KindMismatch) {
     WC->Errors.emplace_back(
         make_error<StringError>(
             "Merge IR generated profile with Clang generated profile.",
@@ -251,29 +271,50 @@ static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
         Filename);
     return;
   }
+  ShardGuards.clear();
+
+  // Collect the records of each shard in batches, so that the lock of a shard
+  // is taken once per batch rather than once per record.
+  const size_t BatchSize = 256;
+  std::vector<std::vector<NamedInstrProfRecord>> Batches(Shards.size());
+  auto AddBatch = [&](size_t ShardIndex) {
+    WriterContext *Shard = Shards[ShardIndex];
+    std::unique_lock<std::mutex> CtxGuard{Shard->Lock};
+    for (NamedInstrProfRecord &I : Batches[ShardIndex]) {
+      const StringRef FuncName = I.Name;
+      bool Reported = false;
+      Shard->Writer.addRecord(std::move(I), Input.Weight, [&](Error E) {
+        if (Reported) {
+          consumeError(std::move(E));
+          return;
+        }
+        Reported = true;
+        // Only show hint the first time an error occurs.
+        instrprof_error IPE = InstrProfError::take(std::move(E));
+        std::unique_lock<std::mutex> ErrGuard{Shard->ErrLock};
+        bool firstTime = Shard->WriterErrorCodes.insert(IPE).second;
+        handleMergeWriterError(make_error<InstrProfError>(IPE), Input.Filename,
+                               FuncName, firstTime);
+      });
+    }
+    Batches[ShardIndex].clear();
+  };
 
   for (auto &I : *Reader) {
     if (Remapper)
       I.Name = (*Remapper)(I.Name);
-    const StringRef FuncName = I.Name;
-    bool Reported = false;
-    WC->Writer.addRecord(std::move(I), Input.Weight, [&](Error E) {
-      if (Reported) {
-        consumeError(std::move(E));
-        return;
-      }
-      Reported = true;
-      // Only show hint the first time an error occurs.
-      instrprof_error IPE = InstrProfError::take(std::move(E));
-      std::unique_lock<std::mutex> ErrGuard{WC->ErrLock};
-      bool firstTime = WC->WriterErrorCodes.insert(IPE).second;
-      handleMergeWriterError(make_error<InstrProfError>(IPE), Input.Filename,
-                             FuncName, firstTime);
-    });
+    size_t ShardIndex = hash_value(I.Name) % Shards.size();
+    Batches[ShardIndex].push_back(std::move(I));
+    if (Batches[ShardIndex].size() == BatchSize)
+      AddBatch(ShardIndex);
   }
+  for (size_t ShardIndex = 0; ShardIndex < Shards.size(); ++ShardIndex)
+    AddBatch(ShardIndex);
   if (Reader->hasError())
-    if (Error E = Reader->getError())
+    if (Error E = Reader->getError()) {
+      std::unique_lock<std::mutex> CtxGuard{WC->Lock};
       WC->Errors.emplace_back(std::move(E), Filename);
+    }
 }
 
 /// Merge the \p Src writer context into \p Dst.
@@ -326,31 +367,30 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
   if (NumThreads == 0)
     NumThreads = std::min(hardware_concurrency().compute_thread_count(),
                           unsigned((Inputs.size() + 1) / 2));
-  // FIXME: There's a bug here, where setting NumThreads = Inputs.size() fails
-  // the merge_empty_profile.test because the InstrProfWriter.ProfileKind isn't
-  // merged, thus the emitted file ends up with a PF_Unknown kind.
 
-  // Initialize the writer contexts.
+  // Initialize the writer contexts. They shard the merged profile by function
+  // name, so peak memory does not grow with the number of threads.
   SmallVector<std::unique_ptr<WriterContext>, 4> Contexts;
-  for (unsigned I = 0; I < NumThreads; ++I)
+  SmallVector<WriterContext *, 4> Shards;
+  for (unsigned I = 0; I < NumThreads; ++I) {
     Contexts.emplace_back(std::make_unique<WriterContext>(
         OutputSparse, ErrorLock, WriterErrorCodes));
+    Shards.push_back(Contexts.back().get());
+  }
 
   if (NumThreads == 1) {
     for (const auto &Input : Inputs)
-      loadInput(Input, Remapper, Contexts[0].get());
+      loadInput(Input, Remapper, Shards);
   } else {
     ThreadPool Pool(hardware_concurrency(NumThreads));
 
     // Load the inputs in parallel (N/NumThreads serial steps).
-    unsigned Ctx = 0;
-    for (const auto &Input : Inputs) {
-      Pool.async(loadInput, Input, Remapper, Contexts[Ctx].get());
-      Ctx = (Ctx + 1) % NumThreads;
-    }
+    for (const auto &Input : Inputs)
+      Pool.async(loadInput, Input, Remapper, makeArrayRef(Shards));
     Pool.wait();
 
-    // Merge the writer contexts together (~ lg(NumThreads) serial steps).
+    // Merge the shards together (~ lg(NumThreads) serial steps). The shards
+    // hold disjoint sets of functions, so this only moves records around.
     unsigned Mid = Contexts.size() / 2;
     unsigned End = Contexts.size();
     assert(Mid > 0 && "Expected more than one context");
@@ -739,7 +779,8 @@ static void overlapInstrProfile(const std::string &BaseFilename,
     OS << "Sum of edge counts for profile " << TestFilename << " is 0.\n";
     exit(0);
   }
-  loadInput(WeightedInput, nullptr, &Context);
+  WriterContext *WC = &Context;
+  loadInput(WeightedInput, nullptr, WC);
   overlapInput(BaseFilename, TestFilename, &Context, Overlap, FuncFilter, OS,
                IsCS);
   Overlap.dump(OS);
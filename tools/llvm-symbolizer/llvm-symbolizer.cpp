@@ -23,6 +23,8 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdio>
@@ -167,14 +169,29 @@ static cl::opt<bool>
     ClUseNativePDBReader("use-native-pdb-reader", cl::init(0),
                          cl::desc("Use native PDB functionality"));
 
+static cl::opt<unsigned> ClNumThreads(
+    "num-threads", cl::init(1),
+    cl::desc("Number of threads to symbolize with (0 = all hardware "
+             "threads). With more than one thread, the input is read and "
+             "symbolized in batches, and the results are printed in input "
+             "order"));
+static cl::alias ClNumThreadsShort("j", cl::desc("Alias for -num-threads"),
+                                   cl::NotHidden, cl::aliasopt(ClNumThreads));
+
+static cl::opt<unsigned> ClMaxCachedModules(
+    "max-cached-modules", cl::init(0),
+    cl::desc("Maximum number of modules to keep loaded. The least recently "
+             "used modules are released when this is exceeded (0 = no "
+             "limit)"));
+
 static cl::extrahelp
     HelpResponse("\nPass @FILE as argument to read options from FILE.\n");
 
 template<typename T>
-static bool error(Expected<T> &ResOrErr) {
+static bool error(Expected<T> &ResOrErr, raw_ostream &ErrOS) {
   if (ResOrErr)
     return false;
-  logAllUnhandledErrors(ResOrErr.takeError(), errs(),
+  logAllUnhandledErrors(ResOrErr.takeError(), ErrOS,
                         "LLVMSymbolizer: error reading file: ");
   return true;
 }
@@ -231,40 +248,41 @@ static bool parseCommand(bool IsAddr2Line, StringRef InputString, Command &Cmd,
 }
 
 static void symbolizeInput(bool IsAddr2Line, StringRef InputString,
-                           LLVMSymbolizer &Symbolizer, DIPrinter &Printer) {
+                           LLVMSymbolizer &Symbolizer, DIPrinter &Printer,
+                           raw_ostream &OS, raw_ostream &ErrOS) {
   Command Cmd;
   std::string ModuleName;
   uint64_t Offset = 0;
   if (!parseCommand(IsAddr2Line, StringRef(InputString), Cmd, ModuleName,
                     Offset)) {
-    outs() << InputString << "\n";
+    OS << InputString << "\n";
     return;
   }
 
   if (ClPrintAddress) {
-    outs() << "0x";
-    outs().write_hex(Offset);
+    OS << "0x";
+    OS.write_hex(Offset);
     StringRef Delimiter = ClPrettyPrint ? ": " : "\n";
-    outs() << Delimiter;
+    OS << Delimiter;
   }
   Offset -= ClAdjustVMA;
   if (Cmd == Command::Data) {
     auto ResOrErr = Symbolizer.symbolizeData(
         ModuleName, {Offset, object::SectionedAddress::UndefSection});
-    Printer << (error(ResOrErr) ? DIGlobal() : ResOrErr.get());
+    Printer << (error(ResOrErr, ErrOS) ? DIGlobal() : ResOrErr.get());
   } else if (Cmd == Command::Frame) {
     auto ResOrErr = Symbolizer.symbolizeFrame(
         ModuleName, {Offset, object::SectionedAddress::UndefSection});
-    if (!error(ResOrErr)) {
+    if (!error(ResOrErr, ErrOS)) {
       for (DILocal Local : *ResOrErr)
         Printer << Local;
       if (ResOrErr->empty())
-        outs() << "??\n";
+        OS << "??\n";
     }
   } else if (ClPrintInlining) {
     auto ResOrErr = Symbolizer.symbolizeInlinedCode(
         ModuleName, {Offset, object::SectionedAddress::UndefSection});
-    Printer << (error(ResOrErr) ? DIInliningInfo() : ResOrErr.get());
+    Printer << (error(ResOrErr, ErrOS) ? DIInliningInfo() : ResOrErr.get());
   } else if (ClOutputStyle == DIPrinter::OutputStyle::GNU) {
     // With ClPrintFunctions == FunctionNameKind::LinkageName (default)
     // and ClUseSymbolTable == true (also default), Symbolizer.symbolizeCode()
@@ -274,14 +292,56 @@ static void symbolizeInput(bool IsAddr2Line, StringRef InputString,
     // the topmost function, which suits our needs better.
     auto ResOrErr = Symbolizer.symbolizeInlinedCode(
         ModuleName, {Offset, object::SectionedAddress::UndefSection});
-    Printer << (error(ResOrErr) ? DILineInfo() : ResOrErr.get().getFrame(0));
+    Printer << (error(ResOrErr, ErrOS) ? DILineInfo()
+                                       : ResOrErr.get().getFrame(0));
   } else {
     auto ResOrErr = Symbolizer.symbolizeCode(
         ModuleName, {Offset, object::SectionedAddress::UndefSection});
-    Printer << (error(ResOrErr) ? DILineInfo() : ResOrErr.get());
+    Printer << (error(ResOrErr, ErrOS) ? DILineInfo() : ResOrErr.get());
   }
   if (ClOutputStyle == DIPrinter::OutputStyle::LLVM)
-    outs() << "\n";
+    OS << "\n";
+}
+
+static DIPrinter createPrinter(raw_ostream &OS) {
+  return DIPrinter(OS, ClPrintFunctions != FunctionNameKind::None,
+                   ClPrettyPrint, ClPrintSourceContextLines, ClVerbose,
+                   ClOutputStyle);
+}
+
+static std::string stripNewlines(StringRef Input) {
+  std::string Stripped(Input);
+  Stripped.erase(std::remove_if(Stripped.begin(), Stripped.end(),
+                                [](char c) { return c == '\r' || c == '\n'; }),
+                 Stripped.end());
+  return Stripped;
+}
+
+// Symbolizes the inputs concurrently, buffering the output of each of them so
+// that it can be printed in input order.
+static void symbolizeInputs(bool IsAddr2Line, ArrayRef<std::string> Inputs,
+                            LLVMSymbolizer &Symbolizer, ThreadPool &Pool) {
+  struct Output {
+    std::string Out;
+    std::string Err;
+  };
+  std::vector<Output> Outputs(Inputs.size());
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+    Pool.async([&, I]() {
+      raw_string_ostream OS(Outputs[I].Out);
+      raw_string_ostream ErrOS(Outputs[I].Err);
+      DIPrinter Printer = createPrinter(OS);
+      symbolizeInput(IsAddr2Line, Inputs[I], Symbolizer, Printer, OS, ErrOS);
+      OS.flush();
+      ErrOS.flush();
+    });
+  }
+  Pool.wait();
+  for (const Output &O : Outputs) {
+    errs() << O.Err;
+    outs() << O.Out;
+  }
+  outs().flush();
 }
 
 int main(int argc, char **argv) {
@@ -318,6 +378,7 @@ int main(int argc, char **argv) {
   Opts.DWPName = ClDwpName;
   Opts.DebugFileDirectory = ClDebugFileDirectory;
   Opts.UseNativePDBReader = ClUseNativePDBReader;
+  Opts.MaxCachedModules = ClMaxCachedModules;
   Opts.PathStyle = DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath;
   // If both --basenames and --relativenames are specified then pick the last
   // one.
@@ -336,27 +397,53 @@ int main(int argc, char **argv) {
   }
   LLVMSymbolizer Symbolizer(Opts);
 
-  DIPrinter Printer(outs(), ClPrintFunctions != FunctionNameKind::None,
-                    ClPrettyPrint, ClPrintSourceContextLines, ClVerbose,
-                    ClOutputStyle);
+  DIPrinter Printer = createPrinter(outs());
 
+  const int kMaxInputStringLength = 1024;
+  char InputString[kMaxInputStringLength];
+
+  // Clients that read the output of each line before they write the next one,
+  // such as the sanitizers, pipe their input. Batching such input would
+  // deadlock them, so only read ahead when the input comes from a file.
+  bool CanReadAhead = true;
   if (ClInputAddresses.empty()) {
-    const int kMaxInputStringLength = 1024;
-    char InputString[kMaxInputStringLength];
+    sys::fs::file_status Status;
+    CanReadAhead = !sys::fs::status(fileno(stdin), Status) &&
+                   Status.type() == sys::fs::file_type::regular_file;
+  }
+
+  if (ClNumThreads != 1 && CanReadAhead) {
+    ThreadPool Pool(hardware_concurrency(ClNumThreads));
+    if (!ClInputAddresses.empty()) {
+      std::vector<std::string> &Inputs = ClInputAddresses;
+      symbolizeInputs(IsAddr2Line, Inputs, Symbolizer, Pool);
+      return 0;
+    }
+    // Bound the memory used for buffering the output by reading the input in
+    // batches.
+    const size_t BatchSize = 1024 * Pool.getThreadCount();
+    std::vector<std::string> Inputs;
+    while (fgets(InputString, sizeof(InputString), stdin)) {
+      Inputs.push_back(stripNewlines(InputString));
+      if (Inputs.size() == BatchSize) {
+        symbolizeInputs(IsAddr2Line, Inputs, Symbolizer, Pool);
+        Inputs.clear();
+      }
+    }
+    symbolizeInputs(IsAddr2Line, Inputs, Symbolizer, Pool);
+    return 0;
+  }
 
+  if (ClInputAddresses.empty()) {
     while (fgets(InputString, sizeof(InputString), stdin)) {
-      // Strip newline characters.
-      std::string StrippedInputString(InputString);
-      StrippedInputString.erase(
-          std::remove_if(StrippedInputString.begin(), StrippedInputString.end(),
-                         [](char c) { return c == '\r' || c == '\n'; }),
-          StrippedInputString.end());
-      symbolizeInput(IsAddr2Line, StrippedInputString, Symbolizer, Printer);
+      symbolizeInput(IsAddr2Line, stripNewlines(InputString), Symbolizer,
+                     Printer, outs(), errs());
       outs().flush();
     }
   } else {
     for (StringRef Address : ClInputAddresses)
-      symbolizeInput(IsAddr2Line, Address, Symbolizer, Printer);
+      symbolizeInput(IsAddr2Line, Address, Symbolizer, Printer, outs(),
+                     errs());
   }
 
   return 0;
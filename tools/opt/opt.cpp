@@ -264,6 +264,17 @@ static cl::opt<unsigned> TimeTraceGranularity(
     cl::desc("Minimum time granularity (in microseconds) traced by time profiler"),
     cl::init(500), cl::Hidden);
 
+static cl::opt<unsigned> TimeTraceMaxEntries(
+    "time-trace-max-entries",
+    cl::desc("Maximum number of entries kept by the time profiler, the oldest "
+             "ones are dropped first (0 = no limit)"),
+    cl::init(0), cl::Hidden);
+
+static cl::opt<unsigned> TimeTraceSampleInterval(
+    "time-trace-sample-interval",
+    cl::desc("Only trace one in every N outermost time profiler sections"),
+    cl::init(1), cl::Hidden);
+
 static cl::opt<std::string>
     TimeTraceFile("time-trace-file",
                     cl::desc("Specify time trace file destination"),
@@ -515,7 +526,8 @@ void exportDebugifyStats(llvm::StringRef Path, const DebugifyStatsMap &Map) {
 struct TimeTracerRAII {
   TimeTracerRAII(StringRef ProgramName) {
     if (TimeTrace)
-      timeTraceProfilerInitialize(TimeTraceGranularity, ProgramName);
+      timeTraceProfilerInitialize(TimeTraceGranularity, ProgramName,
+                                  TimeTraceMaxEntries, TimeTraceSampleInterval);
   }
   ~TimeTracerRAII() {
     if (TimeTrace) {
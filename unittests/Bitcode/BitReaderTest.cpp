@@ -11,6 +11,7 @@
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -255,4 +256,109 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// Tests that metadata strings refer to the bitcode buffer when it is known to
+// outlive the context.
+TEST(BitReaderTest, MDStringsReferToBuffer) {
+  SmallString<1024> Mem;
+  {
+    LLVMContext Context;
+    writeModuleToBuffer(parseAssembly(Context, "!named = !{!0}\n"
+                                               "!0 = !{!\"some string\"}\n"),
+                        Mem);
+  }
+  StringRef Buffer = Mem.str();
+
+  for (bool Outlives : {false, true}) {
+    LLVMContext Context;
+    Context.setBitcodeOutlivesContext(Outlives);
+    Expected<std::unique_ptr<Module>> M =
+        parseBitcodeFile(MemoryBufferRef(Buffer, "test"), Context);
+    ASSERT_TRUE(!!M);
+    auto *N = (*M)->getNamedMetadata("named")->getOperand(0);
+    StringRef Str = cast<MDString>(N->getOperand(0))->getString();
+    EXPECT_EQ("some string", Str);
+    EXPECT_EQ(Outlives, Str.begin() >= Buffer.begin() &&
+                            Str.end() <= Buffer.end());
+  }
+}
+
+// Tests that with on-demand metadata loading, the debug info only referenced
+// by functions that are not materialized is never loaded.
+TEST(BitReaderTest, LoadMetadataOnDemand) {
+  std::string Assembly =
+      "define void @f() !dbg !4 {\n"
+      "  ret void, !dbg !10\n"
+      "}\n"
+      "define void @g() !dbg !7 {\n"
+      "  ret void, !dbg !11\n"
+      "}\n"
+      "define void @h() !dbg !8 {\n"
+      "  ret void, !dbg !12\n"
+      "}\n"
+      "!llvm.dbg.cu = !{!0}\n"
+      "!llvm.module.flags = !{!2}\n"
+      "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, "
+      "emissionKind: FullDebug)\n"
+      "!1 = !DIFile(filename: \"t.c\", directory: \"/\")\n"
+      "!2 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+      "!3 = !DICompositeType(tag: DW_TAG_structure_type, name: \"F\", "
+      "identifier: \"_ZTS1F\")\n"
+      "!4 = distinct !DISubprogram(name: \"f\", type: !5, unit: !0, "
+      "spFlags: DISPFlagDefinition)\n"
+      "!5 = !DISubroutineType(types: !{null, !3})\n"
+      "!6 = !DICompositeType(tag: DW_TAG_structure_type, name: \"G\", "
+      "identifier: \"_ZTS1G\")\n"
+      "!7 = distinct !DISubprogram(name: \"g\", type: !9, unit: !0, "
+      "spFlags: DISPFlagDefinition)\n"
+      "!8 = distinct !DISubprogram(name: \"h\", type: !9, unit: !0, "
+      "spFlags: DISPFlagDefinition)\n"
+      "!9 = !DISubroutineType(types: !{null, !6})\n"
+      "!10 = !DILocation(line: 1, scope: !4)\n"
+      "!11 = !DILocation(line: 2, scope: !7)\n"
+      "!12 = !DILocation(line: 3, scope: !8)\n";
+  // The writer only emits the index that on-demand loading relies on when
+  // the module has enough metadata.
+  std::string Padding = "!llvm.padding = !{";
+  for (unsigned I = 0; I < 32; ++I) {
+    Padding += (I ? ", !" : "!") + std::to_string(100 + I);
+    Assembly += "!" + std::to_string(100 + I) + " = !{!\"padding" +
+                std::to_string(I) + "\"}\n";
+  }
+  Assembly += Padding + "}\n";
+
+  SmallString<1024> Mem;
+  {
+    LLVMContext Context;
+    writeModuleToBuffer(parseAssembly(Context, Assembly.c_str()), Mem);
+  }
+
+  for (bool LoadMetadataOnDemand : {false, true}) {
+    LLVMContext Context;
+    Context.enableDebugTypeODRUniquing();
+    auto IsLoaded = [&](StringRef Identifier) {
+      return DICompositeType::getODRTypeIfExists(
+                 Context, *MDString::get(Context, Identifier)) != nullptr;
+    };
+
+    Expected<std::vector<BitcodeModule>> ModulesOrErr =
+        getBitcodeModuleList(MemoryBufferRef(Mem.str(), "test"));
+    ASSERT_TRUE(!!ModulesOrErr);
+    Expected<std::unique_ptr<Module>> MOrErr =
+        (*ModulesOrErr)[0].getLazyModule(Context,
+                                         /*ShouldLazyLoadMetadata=*/true,
+                                         /*IsImporting=*/false,
+                                         LoadMetadataOnDemand);
+    ASSERT_TRUE(!!MOrErr);
+    Module &M = **MOrErr;
+    EXPECT_FALSE(M.materializeMetadata());
+    EXPECT_FALSE(M.getFunction("f")->materialize());
+    EXPECT_TRUE(IsLoaded("_ZTS1F"));
+    EXPECT_EQ(IsLoaded("_ZTS1G"), !LoadMetadataOnDemand);
+
+    EXPECT_FALSE(M.materializeAll());
+    EXPECT_TRUE(IsLoaded("_ZTS1G"));
+    EXPECT_FALSE(verifyModule(M, &dbgs()));
+  }
+}
+
 } // end namespace
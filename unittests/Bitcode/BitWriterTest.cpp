@@ -0,0 +1,119 @@
+//===- llvm/unittest/Bitcode/BitWriterTest.cpp - Tests for BitWriter ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+/// A module with many functions that have their own constants, value names,
+/// debug locations and metadata attachments, and that refer to each other's
+/// blocks.
+std::unique_ptr<Module> createModule(LLVMContext &Context) {
+  const unsigned NumFunctions = 40;
+  std::string Assembly = "@g = global i32 0\n"
+                         "declare void @ext(i32)\n";
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    std::string N = std::to_string(I);
+    std::string Scope = std::to_string(10 + I);
+    std::string Loc = ", !dbg !DILocation(line: " + std::to_string(I + 1) +
+                      ", scope: !" + Scope + ")\n";
+    Assembly += "define i32 @f" + N + "(i32 %x, i1 %c) !dbg !" + Scope + " {\n"
+                "entry:\n"
+                "  %a = add i32 %x, " + std::to_string(I * 1000003) + Loc +
+                "  store i32 %a, i32* @g, !tbaa !0\n"
+                "  br i1 %c, label %then, label %exit\n"
+                "then:\n"
+                "  call void @ext(i32 " + N + ")" + Loc +
+                "  %r = call i32 @f" + std::to_string((I + 1) % NumFunctions) +
+                "(i32 %a, i1 false)" + Loc +
+                "  br label %exit\n"
+                "exit:\n"
+                "  %p = phi i32 [ %a, %entry ], [ %r, %then ]\n"
+                "  %q = select i1 %c, i8* blockaddress(@f" +
+                std::to_string((I + NumFunctions - 1) % NumFunctions) +
+                ", %then), i8* null\n";
+    // Functions of very different sizes, so that the threads get ranges of
+    // different lengths.
+    for (unsigned J = 0; J != I % 7 * 5; ++J)
+      Assembly += "  %s" + std::to_string(J) + " = mul i32 %p, " +
+                  std::to_string(J + 2) + "\n";
+    Assembly += "  ret i32 %p\n"
+                "}\n";
+  }
+  Assembly += "!llvm.dbg.cu = !{!2}\n"
+              "!llvm.module.flags = !{!4}\n"
+              "!0 = !{!\"int\", !1}\n"
+              "!1 = !{!\"tbaa root\"}\n"
+              "!2 = distinct !DICompileUnit(language: DW_LANG_C99, file: !3, "
+              "emissionKind: FullDebug)\n"
+              "!3 = !DIFile(filename: \"t.c\", directory: \"/\")\n"
+              "!4 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+              "!5 = !DISubroutineType(types: !{})\n";
+  for (unsigned I = 0; I != NumFunctions; ++I)
+    Assembly += "!" + std::to_string(10 + I) +
+                " = distinct !DISubprogram(name: \"f" + std::to_string(I) +
+                "\", type: !5, unit: !2, spFlags: DISPFlagDefinition)\n";
+
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(Assembly, Err, Context);
+  if (!M)
+    report_fatal_error(Err.getMessage());
+  return M;
+}
+
+// Tests that encoding the function blocks on several threads writes the same
+// bytes as encoding them one at a time, with and without a module summary,
+// which records where each function block starts.
+TEST(BitWriterTest, WriteFunctionsInParallel) {
+  auto *EncodeThreads = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions().lookup("bitcode-function-encode-threads"));
+  ASSERT_TRUE(EncodeThreads);
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = createModule(Context);
+  ProfileSummaryInfo PSI(*M);
+  ModuleSummaryIndex Index =
+      buildModuleSummaryIndex(*M, /*GetBFICallback=*/nullptr, &PSI);
+
+  for (bool WithIndex : {false, true}) {
+    auto Write = [&](unsigned Threads) {
+      *EncodeThreads = Threads;
+      SmallString<0> Buffer;
+      raw_svector_ostream OS(Buffer);
+      WriteBitcodeToFile(*M, OS, /*ShouldPreserveUseListOrder=*/false,
+                         WithIndex ? &Index : nullptr);
+      *EncodeThreads = 1;
+      return std::string(Buffer.str());
+    };
+    std::string Serial = Write(1);
+    for (unsigned Threads : {2u, 4u, 0u})
+      EXPECT_TRUE(Serial == Write(Threads))
+          << "Threads=" << Threads << " WithIndex=" << WithIndex;
+
+    LLVMContext ReadContext;
+    Expected<std::unique_ptr<Module>> Read =
+        parseBitcodeFile(MemoryBufferRef(Serial, "test"), ReadContext);
+    ASSERT_TRUE(!!Read);
+    EXPECT_EQ(M->size(), (*Read)->size());
+  }
+}
+
+} // end anonymous namespace
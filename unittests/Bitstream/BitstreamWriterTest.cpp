@@ -55,4 +55,40 @@ TEST(BitstreamWriterTest, emitBlob4ByteAligned) {
   EXPECT_EQ(StringRef("str0"), Buffer);
 }
 
+TEST(BitstreamWriterTest, emitSubblockWithBody) {
+  // Encode the body of a block on its own.
+  SmallString<64> BodyBuffer;
+  size_t BodyBegin, BodyEnd;
+  {
+    BitstreamWriter W(BodyBuffer);
+    W.EnterSubblock(8, 4);
+    BodyBegin = W.GetCurrentBitNo() / 8;
+    W.EmitRecord(1, makeArrayRef<uint64_t>({1, 2, 3}));
+    W.ExitBlock();
+    BodyEnd = W.GetCurrentBitNo() / 8;
+  }
+
+  // Splice it in at a position that is not 32-bit aligned.
+  SmallString<64> Buffer;
+  {
+    BitstreamWriter W(Buffer);
+    W.EmitRecord(2, makeArrayRef<uint64_t>({4}));
+    W.EmitSubblockWithBody(
+        8, 4, ArrayRef<char>(BodyBuffer).slice(BodyBegin, BodyEnd - BodyBegin));
+    W.EmitRecord(3, makeArrayRef<uint64_t>({5}));
+    W.FlushToWord();
+  }
+  SmallString<64> Expected;
+  {
+    BitstreamWriter W(Expected);
+    W.EmitRecord(2, makeArrayRef<uint64_t>({4}));
+    W.EnterSubblock(8, 4);
+    W.EmitRecord(1, makeArrayRef<uint64_t>({1, 2, 3}));
+    W.ExitBlock();
+    W.EmitRecord(3, makeArrayRef<uint64_t>({5}));
+    W.FlushToWord();
+  }
+  EXPECT_EQ(StringRef(Expected), StringRef(Buffer));
+}
+
 } // end namespace
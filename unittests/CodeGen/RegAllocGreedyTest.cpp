@@ -0,0 +1,150 @@
+//===- llvm/unittest/CodeGen/RegAllocGreedyTest.cpp -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+const char *TripleName = "x86_64-unknown-linux-gnu";
+
+class RegAllocGreedyTest : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    InitializeAllTargets();
+    InitializeAllTargetMCs();
+    InitializeAllAsmPrinters();
+  }
+
+  void SetUp() override {
+    std::string Error;
+    // FIXME: These tests do not depend on X86 specifically, but we have to
+    // generate code for some target.
+    T = TargetRegistry::lookupTarget(TripleName, Error);
+    HugeFunctionThreshold = static_cast<cl::opt<unsigned> *>(
+        cl::getRegisteredOptions().lookup("regalloc-huge-function-threshold"));
+    CSRFirstTimeCost = static_cast<cl::opt<unsigned> *>(
+        cl::getRegisteredOptions().lookup("regalloc-csr-first-time-cost"));
+  }
+
+  void TearDown() override {
+    if (HugeFunctionThreshold)
+      *HugeFunctionThreshold = 0;
+    if (CSRFirstTimeCost)
+      *CSRFirstTimeCost = 0;
+  }
+
+  /// Generate code for \p Assembly at -O2, which allocates registers with the
+  /// greedy allocator and verifies the result, and return the statistics that
+  /// were collected.
+  StringMap<unsigned> compile(StringRef Assembly) {
+    LLVMContext Context;
+    SMDiagnostic Err;
+    std::unique_ptr<Module> M = parseAssemblyString(Assembly, Err, Context);
+    if (!M)
+      report_fatal_error(Err.getMessage());
+    std::unique_ptr<TargetMachine> TM(
+        T->createTargetMachine(TripleName, "", "", TargetOptions(), None, None,
+                               CodeGenOpt::Default));
+    M->setTargetTriple(TripleName);
+    M->setDataLayout(TM->createDataLayout());
+
+    SmallString<0> Buffer;
+    raw_svector_ostream OS(Buffer);
+    legacy::PassManager PM;
+    if (TM->addPassesToEmitFile(PM, OS, nullptr, CGFT_AssemblyFile,
+                                /*DisableVerify=*/false))
+      report_fatal_error("Failed to setup codegen");
+
+    EnableStatistics(/*PrintOnExit=*/false);
+    ResetStatistics();
+    PM.run(*M);
+
+    StringMap<unsigned> Stats;
+    for (const auto &Stat : GetStatistics())
+      Stats[Stat.first] = Stat.second;
+    return Stats;
+  }
+
+  /// A function whose live ranges cross a cold call, which the allocator
+  /// splits around the cold block.
+  static std::string createInput() {
+    std::string Assembly = "declare void @g()\n"
+                           "define i64 @f(i64* %p, i1 %c) {\n"
+                           "entry:\n";
+    for (unsigned I = 0; I != 16; ++I)
+      Assembly +=
+          "  %a" + std::to_string(I) + " = load volatile i64, i64* %p\n";
+    Assembly += "  br i1 %c, label %cold, label %hot\n"
+                "cold:\n"
+                "  call void @g()\n"
+                "  br label %hot\n"
+                "hot:\n"
+                "  %s0 = add i64 %a0, 0\n";
+    for (unsigned I = 1; I != 16; ++I)
+      Assembly += "  %s" + std::to_string(I) + " = add i64 %s" +
+                  std::to_string(I - 1) + ", %a" + std::to_string(I) + "\n";
+    Assembly += "  ret i64 %s15\n"
+                "}\n";
+    return Assembly;
+  }
+
+  const Target *T = nullptr;
+  cl::opt<unsigned> *HugeFunctionThreshold = nullptr;
+  cl::opt<unsigned> *CSRFirstTimeCost = nullptr;
+};
+
+#if LLVM_ENABLE_STATS
+TEST_F(RegAllocGreedyTest, HugeFunctionSkipsRegionSplitting) {
+  if (!T)
+    return;
+  ASSERT_TRUE(HugeFunctionThreshold);
+
+  std::string Assembly = createInput();
+  StringMap<unsigned> Stats = compile(Assembly);
+  EXPECT_EQ(0u, Stats.lookup("NumHugeFunctions"));
+  EXPECT_LT(0u, Stats.lookup("NumGlobalSplits"));
+
+  *HugeFunctionThreshold = 1;
+  Stats = compile(Assembly);
+  EXPECT_EQ(1u, Stats.lookup("NumHugeFunctions"));
+  EXPECT_EQ(0u, Stats.lookup("NumGlobalSplits"));
+}
+
+TEST_F(RegAllocGreedyTest, HugeFunctionSkipsCSRPreSplitting) {
+  if (!T)
+    return;
+  ASSERT_TRUE(HugeFunctionThreshold);
+  ASSERT_TRUE(CSRFirstTimeCost);
+
+  // With a high cost for the first use of a callee-saved register, the
+  // allocator tries region splits before it uses one.
+  *CSRFirstTimeCost = 100000;
+  std::string Assembly = createInput();
+  StringMap<unsigned> Stats = compile(Assembly);
+  EXPECT_LT(0u, Stats.lookup("NumGlobalSplits"));
+
+  *HugeFunctionThreshold = 1;
+  Stats = compile(Assembly);
+  EXPECT_EQ(1u, Stats.lookup("NumHugeFunctions"));
+  EXPECT_EQ(0u, Stats.lookup("NumGlobalSplits"));
+}
+#endif
+
+} // end anonymous namespace
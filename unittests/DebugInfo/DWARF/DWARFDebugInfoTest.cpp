@@ -27,11 +27,16 @@
 #include "llvm/ObjectYAML/DWARFEmitter.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Testing/Support/Error.h"
 #include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <thread>
 
 using namespace llvm;
 using namespace dwarf;
@@ -3201,4 +3206,187 @@ TEST(DWARFDebugInfo, TestDWARF64UnitLength) {
   });
 }
 
+TEST(DWARFDebugInfo, TestIndexesWithThreadPool) {
+  // Two compile units without .debug_aranges or accelerator tables, which
+  // both define a function named foo.
+  const char *yamldata = R"(
+    debug_abbrev:
+      - Code:            0x00000001
+        Tag:             DW_TAG_compile_unit
+        Children:        DW_CHILDREN_yes
+        Attributes:
+          - Attribute:       DW_AT_name
+            Form:            DW_FORM_string
+          - Attribute:       DW_AT_low_pc
+            Form:            DW_FORM_addr
+          - Attribute:       DW_AT_high_pc
+            Form:            DW_FORM_data4
+      - Code:            0x00000002
+        Tag:             DW_TAG_subprogram
+        Children:        DW_CHILDREN_no
+        Attributes:
+          - Attribute:       DW_AT_name
+            Form:            DW_FORM_string
+          - Attribute:       DW_AT_linkage_name
+            Form:            DW_FORM_string
+      - Code:            0x00000003
+        Tag:             DW_TAG_subprogram
+        Children:        DW_CHILDREN_no
+        Attributes:
+          - Attribute:       DW_AT_name
+            Form:            DW_FORM_string
+    debug_info:
+      - Length:          0
+        Version:         4
+        AbbrOffset:      0
+        AddrSize:        8
+        Entries:
+          - AbbrCode:        0x00000001
+            Values:
+              - CStr:            a.c
+              - Value:           0x0000000000001000
+              - Value:           0x0000000000000100
+          - AbbrCode:        0x00000002
+            Values:
+              - CStr:            foo
+              - CStr:            _Z3foov
+          - AbbrCode:        0x00000003
+            Values:
+              - CStr:            bar
+          - AbbrCode:        0x00000000
+            Values:
+      - Length:          0
+        Version:         4
+        AbbrOffset:      0
+        AddrSize:        8
+        Entries:
+          - AbbrCode:        0x00000001
+            Values:
+              - CStr:            b.c
+              - Value:           0x0000000000002000
+              - Value:           0x0000000000000100
+          - AbbrCode:        0x00000003
+            Values:
+              - CStr:            foo
+          - AbbrCode:        0x00000000
+            Values:
+  )";
+  auto ErrOrSections = DWARFYAML::emitDebugSections(StringRef(yamldata), true);
+  ASSERT_TRUE((bool)ErrOrSections);
+
+  ThreadPool Pool(hardware_concurrency(2));
+  for (ThreadPool *P : {(ThreadPool *)nullptr, &Pool}) {
+    std::unique_ptr<DWARFContext> DwarfContext =
+        DWARFContext::create(*ErrOrSections, 8);
+    ASSERT_EQ(DwarfContext->getNumCompileUnits(), 2u);
+    DWARFUnit *CU1 = DwarfContext->getUnitAtIndex(0);
+    DWARFUnit *CU2 = DwarfContext->getUnitAtIndex(1);
+
+    const DWARFContext::DIENameIndex &Index = DwarfContext->getDIENameIndex(P);
+    EXPECT_EQ(Index.count("a.c"), 1u);
+    EXPECT_EQ(Index.count("missing"), 0u);
+
+    // The DIEs for a name are listed in the order of the units.
+    auto Foo = Index.find("foo");
+    ASSERT_NE(Foo, Index.end());
+    ASSERT_EQ(Foo->second.size(), 2u);
+    EXPECT_EQ(Foo->second[0].getDwarfUnit(), CU1);
+    EXPECT_EQ(Foo->second[1].getDwarfUnit(), CU2);
+
+    auto Linkage = Index.find("_Z3foov");
+    ASSERT_NE(Linkage, Index.end());
+    ASSERT_EQ(Linkage->second.size(), 1u);
+    EXPECT_EQ(Linkage->second[0], Foo->second[0]);
+
+    const DWARFDebugAranges *Aranges = DwarfContext->getDebugAranges(P);
+    EXPECT_EQ(Aranges->findAddress(0x1010), CU1->getOffset());
+    EXPECT_EQ(Aranges->findAddress(0x2010), CU2->getOffset());
+    EXPECT_EQ(Aranges->findAddress(0x3000), -1ULL);
+  }
+}
+
+TEST(DWARFDebugInfo, TestHandlersSerializedWithThreadPool) {
+  // DWARF v5 compile units whose DW_AT_str_offsets_base points past the end
+  // of the missing .debug_str_offsets section, so that parsing each unit
+  // reports a recoverable error.
+  std::string Yaml = R"(
+    debug_abbrev:
+      - Code:            0x00000001
+        Tag:             DW_TAG_compile_unit
+        Children:        DW_CHILDREN_yes
+        Attributes:
+          - Attribute:       DW_AT_str_offsets_base
+            Form:            DW_FORM_sec_offset
+      - Code:            0x00000002
+        Tag:             DW_TAG_subprogram
+        Children:        DW_CHILDREN_no
+        Attributes:
+          - Attribute:       DW_AT_name
+            Form:            DW_FORM_string
+    debug_info:
+)";
+  const unsigned NumUnits = 16;
+  for (unsigned I = 0; I != NumUnits; ++I)
+    Yaml += R"(
+      - Length:          0
+        Version:         5
+        UnitType:        DW_UT_compile
+        AbbrOffset:      0
+        AddrSize:        8
+        Entries:
+          - AbbrCode:        0x00000001
+            Values:
+              - Value:           0x0000000000000100
+          - AbbrCode:        0x00000002
+            Values:
+              - CStr:            f
+          - AbbrCode:        0x00000000
+            Values:
+)";
+  auto ErrOrSections = DWARFYAML::emitDebugSections(Yaml, true);
+  ASSERT_TRUE((bool)ErrOrSections);
+
+  std::atomic<bool> InHandler(false);
+  std::atomic<unsigned> NumOverlaps(0);
+  std::atomic<unsigned> NumErrors(0);
+  auto Handler = [&](Error E) {
+    if (InHandler.exchange(true))
+      ++NumOverlaps;
+    // Stay in the handler for a while, so that concurrent calls overlap.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    consumeError(std::move(E));
+    ++NumErrors;
+    InHandler = false;
+  };
+  auto CreateContext = [&] {
+    return DWARFContext::create(*ErrOrSections, 8, sys::IsLittleEndianHost,
+                                Handler, Handler);
+  };
+
+  ThreadPool Pool(hardware_concurrency(4));
+  std::vector<std::function<void(DWARFContext &)>> Parsers = {
+      [&](DWARFContext &Ctx) { Ctx.parseAllUnitDIEs(Pool); },
+      [&](DWARFContext &Ctx) { Ctx.parseAllUnitDIEs(); },
+      [&](DWARFContext &Ctx) { Ctx.getDIENameIndex(&Pool); },
+      [&](DWARFContext &Ctx) { Ctx.getDebugAranges(&Pool); },
+  };
+  for (const auto &Parse : Parsers) {
+    NumErrors = 0;
+    std::unique_ptr<DWARFContext> DwarfContext = CreateContext();
+    ASSERT_EQ(DwarfContext->getNumCompileUnits(), NumUnits);
+    Parse(*DwarfContext);
+    EXPECT_EQ(NumOverlaps, 0u);
+    EXPECT_EQ(NumErrors, NumUnits);
+    for (unsigned I = 0; I != NumUnits; ++I)
+      EXPECT_EQ(DwarfContext->getUnitAtIndex(I)->getNumDIEs(), 3u);
+
+    // The original handlers are restored afterwards.
+    DwarfContext->getRecoverableErrorHandler()(
+        createStringError(errc::invalid_argument, "error"));
+    DwarfContext->getWarningHandler()(
+        createStringError(errc::invalid_argument, "warning"));
+    EXPECT_EQ(NumErrors, NumUnits + 2);
+  }
+}
+
 } // end anonymous namespace
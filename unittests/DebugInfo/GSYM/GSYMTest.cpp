@@ -1403,6 +1403,65 @@ TEST(GSYMTest, TestGsymLookups) {
     testing::ElementsAre(SourceLocation{"main", "/tmp", "main.c", 8, 32}));
 }
 
+TEST(GSYMTest, TestGsymBatchLookups) {
+  // Test that batched lookups return the same results as single lookups,
+  // regardless of the order of the addresses, including for addresses that
+  // are not in the GSYM.
+  GsymCreator GC;
+  FunctionInfo FI(0x1000, 0x100, GC.insertString("main"));
+  const auto ByteOrder = support::endian::system_endianness();
+  FI.OptLineTable = LineTable();
+  const uint32_t MainFileIndex = GC.insertFile("/tmp/main.c");
+  const uint32_t FooFileIndex = GC.insertFile("/tmp/foo.h");
+  FI.OptLineTable->push(LineEntry(0x1000, MainFileIndex, 5));
+  FI.OptLineTable->push(LineEntry(0x1010, FooFileIndex, 10));
+  FI.OptLineTable->push(LineEntry(0x1012, FooFileIndex, 20));
+  FI.OptLineTable->push(LineEntry(0x1020, MainFileIndex, 8));
+  FI.Inline = InlineInfo();
+  FI.Inline->Name = GC.insertString("inline1");
+  FI.Inline->CallFile = MainFileIndex;
+  FI.Inline->CallLine = 6;
+  FI.Inline->Ranges.insert(AddressRange(0x1010, 0x1020));
+  GC.addFunctionInfo(std::move(FI));
+  // A function without a line table, with a gap before it.
+  GC.addFunctionInfo(FunctionInfo(0x1200, 0x10, GC.insertString("foo")));
+  Error FinalizeErr = GC.finalize(llvm::nulls());
+  ASSERT_FALSE(FinalizeErr);
+  SmallString<512> Str;
+  raw_svector_ostream OutStrm(Str);
+  FileWriter FW(OutStrm, ByteOrder);
+  llvm::Error Err = GC.encode(FW);
+  ASSERT_FALSE((bool)Err);
+  Expected<GsymReader> GR = GsymReader::copyBuffer(OutStrm.str());
+  ASSERT_TRUE(bool(GR));
+
+  const uint64_t Addrs[] = {0x1210, 0x1011, 0x0FFF, 0x1000, 0x1200, 0x1150,
+                            0x1012, 0x1020, 0x1011, 0x100F, 0x120F, 0x1010};
+  std::vector<bool> Seen(array_lengthof(Addrs), false);
+  uint64_t PrevAddr = 0;
+  GR->lookup(Addrs, [&](size_t Index, Expected<const LookupResult &> LR) {
+    ASSERT_LT(Index, array_lengthof(Addrs));
+    EXPECT_FALSE(Seen[Index]);
+    Seen[Index] = true;
+    // Results are reported in order of increasing address.
+    EXPECT_LE(PrevAddr, Addrs[Index]);
+    PrevAddr = Addrs[Index];
+
+    auto SingleLR = GR->lookup(Addrs[Index]);
+    if (!SingleLR) {
+      std::string ExpectedErr = toString(SingleLR.takeError());
+      EXPECT_THAT_EXPECTED(LR, FailedWithMessage(ExpectedErr));
+      return;
+    }
+    ASSERT_THAT_EXPECTED(LR, Succeeded());
+    EXPECT_EQ(LR->LookupAddr, Addrs[Index]);
+    EXPECT_EQ(LR->FuncRange, SingleLR->FuncRange);
+    EXPECT_EQ(LR->FuncName, SingleLR->FuncName);
+    EXPECT_EQ(LR->Locations, SingleLR->Locations);
+  });
+  EXPECT_THAT(Seen, testing::Each(true));
+}
+
 
 TEST(GSYMTest, TestDWARFFunctionWithAddresses) {
   // Create a single compile unit with a single function and make sure it gets
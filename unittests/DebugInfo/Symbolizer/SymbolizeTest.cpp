@@ -0,0 +1,158 @@
+//===- llvm/unittest/DebugInfo/Symbolizer/SymbolizeTest.cpp ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/Symbolize/Symbolize.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ObjectYAML/yaml2obj.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <atomic>
+
+using namespace llvm;
+using namespace symbolize;
+
+namespace {
+
+const uint64_t FunctionAddress = 0x1000;
+
+/// Writes executables that each define one function, so that the module a
+/// query was answered from can be told by the function name. Whether a module
+/// is still cached is checked by deleting its file: queries for a cached
+/// module keep working, while a module that was evicted fails to load again.
+class SymbolizeTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("symbolize-test", TestDir));
+  }
+
+  void TearDown() override { sys::fs::remove_directories(TestDir); }
+
+  std::string writeModule(StringRef FunctionName) {
+    SmallString<128> Path(TestDir);
+    sys::path::append(Path, FunctionName);
+    std::string Yaml = (R"(
+--- !ELF
+FileHeader:
+  Class:    ELFCLASS64
+  Data:     ELFDATA2LSB
+  Type:     ET_EXEC
+  Machine:  EM_X86_64
+Sections:
+  - Name:    .text
+    Type:    SHT_PROGBITS
+    Flags:   [ SHF_ALLOC, SHF_EXECINSTR ]
+    Address: 0x1000
+    Size:    0x10
+Symbols:
+  - Name:    )" + FunctionName + R"(
+    Type:    STT_FUNC
+    Section: .text
+    Value:   0x1000
+    Size:    0x10
+    Binding: STB_GLOBAL
+)").str();
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC);
+    EXPECT_FALSE(EC);
+    yaml::Input YIn(Yaml);
+    EXPECT_TRUE(yaml::convertYAML(YIn, OS, [](const Twine &) {}));
+    return Path.str().str();
+  }
+
+  /// Returns the function at FunctionAddress in \p Path, or "<error>" if the
+  /// module could not be loaded.
+  static std::string symbolize(LLVMSymbolizer &Symbolizer,
+                               const std::string &Path) {
+    Expected<DILineInfo> Info = Symbolizer.symbolizeCode(
+        Path, {FunctionAddress, object::SectionedAddress::UndefSection});
+    if (!Info) {
+      consumeError(Info.takeError());
+      return "<error>";
+    }
+    return Info->FunctionName;
+  }
+
+  SmallString<128> TestDir;
+};
+
+TEST_F(SymbolizeTest, UnboundedCacheKeepsModules) {
+  LLVMSymbolizer Symbolizer;
+  std::string A = writeModule("fa");
+  std::string B = writeModule("fb");
+  EXPECT_EQ("fa", symbolize(Symbolizer, A));
+  EXPECT_EQ("fb", symbolize(Symbolizer, B));
+
+  ASSERT_FALSE(sys::fs::remove(A));
+  ASSERT_FALSE(sys::fs::remove(B));
+  EXPECT_EQ("fa", symbolize(Symbolizer, A));
+  EXPECT_EQ("fb", symbolize(Symbolizer, B));
+}
+
+TEST_F(SymbolizeTest, EvictsLeastRecentlyUsedModule) {
+  LLVMSymbolizer::Options Opts;
+  Opts.MaxCachedModules = 2;
+  LLVMSymbolizer Symbolizer(Opts);
+  std::string A = writeModule("fa");
+  std::string B = writeModule("fb");
+  std::string C = writeModule("fc");
+
+  // Using A again makes B the least recently used module, so loading C
+  // evicts B.
+  EXPECT_EQ("fa", symbolize(Symbolizer, A));
+  EXPECT_EQ("fb", symbolize(Symbolizer, B));
+  EXPECT_EQ("fa", symbolize(Symbolizer, A));
+  EXPECT_EQ("fc", symbolize(Symbolizer, C));
+
+  ASSERT_FALSE(sys::fs::remove(A));
+  ASSERT_FALSE(sys::fs::remove(B));
+  ASSERT_FALSE(sys::fs::remove(C));
+  EXPECT_EQ("fa", symbolize(Symbolizer, A));
+  EXPECT_EQ("fc", symbolize(Symbolizer, C));
+  EXPECT_EQ("<error>", symbolize(Symbolizer, B));
+}
+
+TEST_F(SymbolizeTest, FlushReleasesModules) {
+  LLVMSymbolizer Symbolizer;
+  std::string A = writeModule("fa");
+  EXPECT_EQ("fa", symbolize(Symbolizer, A));
+
+  ASSERT_FALSE(sys::fs::remove(A));
+  Symbolizer.flush();
+  EXPECT_EQ("<error>", symbolize(Symbolizer, A));
+}
+
+TEST_F(SymbolizeTest, ConcurrentQueries) {
+  // Fewer cached modules than modules in use, so that modules are evicted and
+  // reloaded while other threads query them.
+  LLVMSymbolizer::Options Opts;
+  Opts.MaxCachedModules = 2;
+  LLVMSymbolizer Symbolizer(Opts);
+  std::vector<std::string> Names, Paths;
+  for (unsigned I = 0; I != 6; ++I) {
+    Names.push_back("f" + std::to_string(I));
+    Paths.push_back(writeModule(Names.back()));
+  }
+
+  std::atomic<unsigned> NumMismatches(0);
+  {
+    ThreadPool Pool(hardware_concurrency(4));
+    for (unsigned I = 0; I != 600; ++I)
+      Pool.async([&, I]() {
+        unsigned Module = (I * 7) % Names.size();
+        if (symbolize(Symbolizer, Paths[Module]) != Names[Module])
+          ++NumMismatches;
+      });
+  }
+  EXPECT_EQ(0u, NumMismatches);
+}
+
+} // end anonymous namespace
@@ -270,6 +270,49 @@ TEST_F(CoreAPIsStandardTest, LookupWithHiddenSymbols) {
       << "Wrong result for \"Bar\"";
 }
 
+TEST_F(CoreAPIsStandardTest, LookupReadySymbols) {
+  // Test that repeated lookups of symbols that are already Ready (which do not
+  // take the session lock) agree with the original lookup, respect hidden
+  // symbols, and see symbol removal.
+  auto BarHiddenFlags = BarSym.getFlags() & ~JITSymbolFlags::Exported;
+  auto BarHiddenSym = JITEvaluatedSymbol(BarSym.getAddress(), BarHiddenFlags);
+
+  cantFail(JD.define(absoluteSymbols({{Foo, FooSym}, {Bar, BarHiddenSym}})));
+
+  auto &JD2 = ES.createBareJITDylib("JD2");
+  cantFail(JD2.define(absoluteSymbols({{Bar, QuxSym}})));
+
+  auto SearchOrder = makeJITDylibSearchOrder({&JD, &JD2});
+  auto Expected = cantFail(ES.lookup(SearchOrder, SymbolLookupSet({Foo, Bar})));
+  EXPECT_EQ(Expected[Bar].getAddress(), QuxSym.getAddress())
+      << "Wrong result for \"Bar\"";
+
+  auto CheckLookups = [&]() {
+    for (unsigned I = 0; I != 100; ++I) {
+      auto Result = cantFail(ES.lookup(SearchOrder, SymbolLookupSet({Foo, Bar})));
+      EXPECT_EQ(Result.size(), 2U) << "Unexpected number of results";
+      EXPECT_EQ(Result[Foo].getAddress(), FooSym.getAddress())
+          << "Wrong result for \"Foo\"";
+      EXPECT_EQ(Result[Bar].getAddress(), QuxSym.getAddress())
+          << "Wrong result for \"Bar\"";
+    }
+  };
+
+#if LLVM_ENABLE_THREADS
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I != 4; ++I)
+    Threads.emplace_back(CheckLookups);
+  for (auto &T : Threads)
+    T.join();
+#else
+  CheckLookups();
+#endif
+
+  cantFail(JD.remove({Foo}));
+  EXPECT_THAT_EXPECTED(ES.lookup(makeJITDylibSearchOrder(&JD), Foo), Failed())
+      << "Lookup of removed symbol should fail";
+}
+
 TEST_F(CoreAPIsStandardTest, LookupFlagsTest) {
   // Test that lookupFlags works on a predefined symbol, and does not trigger
   // materialization of a lazy symbol. Make the lazy symbol weak to test that
@@ -0,0 +1,93 @@
+//===-- LocalObjectCacheTest.cpp - Unit tests for the on-disk ObjectCache -===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/LocalObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class LocalObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        sys::fs::createUniqueDirectory("orc-object-cache-test", CacheDir));
+  }
+
+  void TearDown() override { sys::fs::remove_directories(CacheDir); }
+
+  std::unique_ptr<Module> createModule(StringRef FnName) {
+    auto M = std::make_unique<Module>("M", Ctx);
+    Function::Create(FunctionType::get(Type::getVoidTy(Ctx), false),
+                     GlobalValue::ExternalLinkage, FnName, *M);
+    return M;
+  }
+
+  LLVMContext Ctx;
+  SmallString<128> CacheDir;
+};
+
+TEST_F(LocalObjectCacheTest, MissThenHit) {
+  auto M = createModule("foo");
+  StringRef Obj = "not really an object file";
+
+  {
+    auto Cache = LocalObjectCache::Create(CacheDir, "prefix");
+    ASSERT_THAT_EXPECTED(Cache, Succeeded());
+    EXPECT_EQ((*Cache)->getObject(M.get()), nullptr);
+    (*Cache)->notifyObjectCompiled(M.get(), MemoryBufferRef(Obj, "obj"));
+  }
+
+  // A new cache instance on the same directory sees the entry.
+  auto Cache = LocalObjectCache::Create(CacheDir, "prefix");
+  ASSERT_THAT_EXPECTED(Cache, Succeeded());
+  auto Cached = (*Cache)->getObject(M.get());
+  ASSERT_NE(Cached, nullptr);
+  EXPECT_EQ(Cached->getBuffer(), Obj);
+}
+
+TEST_F(LocalObjectCacheTest, KeyDependsOnModuleAndPrefix) {
+  auto Foo = createModule("foo");
+  auto Bar = createModule("bar");
+
+  auto CacheA = LocalObjectCache::Create(CacheDir, "a");
+  auto CacheB = LocalObjectCache::Create(CacheDir, "b");
+  ASSERT_THAT_EXPECTED(CacheA, Succeeded());
+  ASSERT_THAT_EXPECTED(CacheB, Succeeded());
+
+  EXPECT_EQ((*CacheA)->getKey(*Foo), (*CacheA)->getKey(*Foo));
+  EXPECT_NE((*CacheA)->getKey(*Foo), (*CacheA)->getKey(*Bar));
+  EXPECT_NE((*CacheA)->getKey(*Foo), (*CacheB)->getKey(*Foo));
+
+  (*CacheA)->notifyObjectCompiled(Foo.get(), MemoryBufferRef("obj", "obj"));
+  EXPECT_EQ((*CacheB)->getObject(Foo.get()), nullptr);
+}
+
+TEST_F(LocalObjectCacheTest, KeyPrefixFromJITTargetMachineBuilder) {
+  JITTargetMachineBuilder JTMB((Triple("x86_64-unknown-linux-gnu")));
+  std::string Prefix = LocalObjectCache::getKeyPrefix(JTMB);
+  EXPECT_EQ(Prefix, LocalObjectCache::getKeyPrefix(JTMB));
+
+  JTMB.setCPU("skylake");
+  EXPECT_NE(Prefix, LocalObjectCache::getKeyPrefix(JTMB));
+  Prefix = LocalObjectCache::getKeyPrefix(JTMB);
+
+  JTMB.setCodeGenOptLevel(CodeGenOpt::Aggressive);
+  EXPECT_NE(Prefix, LocalObjectCache::getKeyPrefix(JTMB));
+}
+
+} // namespace
@@ -168,6 +168,23 @@ TEST_F(MDStringTest, PrintingComplex) {
   EXPECT_STREQ("!\"\\00\\0A\\22\\\\\\FF\"", oss.str().c_str());
 }
 
+// Test that an external MDString refers to the string it was created from,
+// and is uniqued together with copied ones.
+TEST_F(MDStringTest, CreateExternal) {
+  char x[4] = { 'a', 'b', 'c', 'X' };
+  char y[4] = { 'a', 'b', 'c', 'Y' };
+
+  MDString *s1 = MDString::getExternal(Context, StringRef(&x[0], 3));
+  EXPECT_EQ(&x[0], s1->getString().data());
+  EXPECT_EQ(s1, MDString::get(Context, StringRef(&y[0], 3)));
+  EXPECT_EQ(s1, MDString::getExternal(Context, StringRef(&y[0], 3)));
+
+  // A copied string stays copied.
+  MDString *s2 = MDString::get(Context, StringRef(&y[1], 2));
+  EXPECT_NE(&y[1], s2->getString().data());
+  EXPECT_EQ(s2, MDString::getExternal(Context, StringRef(&x[1], 2)));
+}
+
 typedef MetadataTest MDNodeTest;
 
 // Test the two constructors, and containing other Constants.
@@ -0,0 +1,154 @@
+//===- ParallelFunctionPassAdaptorTest.cpp --------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Passes/ParallelFunctionPassAdaptor.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// A module with named struct types, debug info, calls that instcombine turns
+// into a new intrinsic declaration, and a function with a blockaddress table.
+const char *IR = R"(
+  %struct.pair = type { i32, i32 }
+
+  @.str = private unnamed_addr constant [4 x i8] c"abc\00", align 1
+  @table = internal constant [2 x i8*] [i8* blockaddress(@dispatch, %a),
+                                        i8* blockaddress(@dispatch, %b)]
+
+  declare i8* @strcpy(i8*, i8*)
+
+  define i32 @sum(%struct.pair* %p) !dbg !6 {
+    %x.addr = getelementptr %struct.pair, %struct.pair* %p, i32 0, i32 0
+    %y.addr = getelementptr %struct.pair, %struct.pair* %p, i32 0, i32 1
+    %x = load i32, i32* %x.addr, !dbg !9
+    %y = load i32, i32* %y.addr, !dbg !9
+    %s = add i32 %x, %y, !dbg !9
+    %t = add i32 %s, 0, !dbg !9
+    ret i32 %t, !dbg !9
+  }
+
+  define internal i32 @twice(i32 %v) !dbg !10 {
+    %m = mul i32 %v, 2, !dbg !11
+    %c = icmp eq i32 %v, %v
+    br i1 %c, label %then, label %else
+  then:
+    ret i32 %m, !dbg !11
+  else:
+    ret i32 0
+  }
+
+  define i8* @copy(i8* %dst) {
+    %src = getelementptr [4 x i8], [4 x i8]* @.str, i32 0, i32 0
+    %r = call i8* @strcpy(i8* %dst, i8* %src)
+    ret i8* %r
+  }
+
+  define i32 @caller(%struct.pair* %p) {
+    %a = call i32 @sum(%struct.pair* %p)
+    %b = call i32 @twice(i32 %a)
+    %c = xor i32 %b, 0
+    ret i32 %c
+  }
+
+  define i32 @dispatch(i32 %i) {
+  entry:
+    %slot = getelementptr [2 x i8*], [2 x i8*]* @table, i32 0, i32 %i
+    %target = load i8*, i8** %slot
+    indirectbr i8* %target, [label %a, label %b]
+  a:
+    %x = add i32 %i, 0
+    ret i32 %x
+  b:
+    ret i32 1
+  }
+
+  !llvm.dbg.cu = !{!0}
+  !llvm.module.flags = !{!3, !4}
+
+  !0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+  !1 = !DIFile(filename: "t.c", directory: "/")
+  !2 = !{}
+  !3 = !{i32 2, !"Dwarf Version", i32 4}
+  !4 = !{i32 2, !"Debug Info Version", i32 3}
+  !5 = !DISubroutineType(types: !2)
+  !6 = distinct !DISubprogram(name: "sum", scope: !1, file: !1, line: 1, type: !5, scopeLine: 1, spFlags: DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+  !7 = distinct !DILexicalBlock(scope: !6, file: !1, line: 2, column: 3)
+  !9 = !DILocation(line: 3, column: 5, scope: !7)
+  !10 = distinct !DISubprogram(name: "twice", scope: !1, file: !1, line: 5, type: !5, scopeLine: 5, spFlags: DISPFlagLocalToUnit | DISPFlagDefinition | DISPFlagOptimized, unit: !0, retainedNodes: !2)
+  !11 = !DILocation(line: 6, column: 3, scope: !10)
+)";
+
+std::string optimize(StringRef Pipeline) {
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  if (!M) {
+    Err.print("ParallelFunctionPassAdaptorTest", errs());
+    return "";
+  }
+
+  PassBuilder PB;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  ModulePassManager MPM;
+  EXPECT_THAT_ERROR(PB.parsePassPipeline(MPM, Pipeline), Succeeded());
+  MPM.run(*M, MAM);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  std::string Result;
+  raw_string_ostream OS(Result);
+  M->print(OS, nullptr);
+  return OS.str();
+}
+
+TEST(ParallelFunctionPassAdaptorTest, MatchesSerialAdaptor) {
+  std::string Serial = optimize("function(instcombine,simplifycfg)");
+  ASSERT_FALSE(Serial.empty());
+  // The blockaddress table is not folded away.
+  EXPECT_NE(Serial.find("blockaddress(@dispatch, %a)"), std::string::npos);
+  // instcombine replaced strcpy with a new memcpy intrinsic declaration.
+  EXPECT_NE(Serial.find("declare void @llvm.memcpy"), std::string::npos);
+
+  for (StringRef Pipeline :
+       {"parallel-function<2>(instcombine,simplifycfg)",
+        "parallel-function<4>(instcombine,simplifycfg)",
+        "parallel-function<16>(instcombine,simplifycfg)"})
+    EXPECT_EQ(Serial, optimize(Pipeline)) << Pipeline;
+}
+
+TEST(ParallelFunctionPassAdaptorTest, ParsePipeline) {
+  PassBuilder PB;
+  ModulePassManager MPM;
+  EXPECT_THAT_ERROR(
+      PB.parsePassPipeline(MPM, "parallel-function(loop(licm),instcombine)"),
+      Succeeded());
+  EXPECT_THAT_ERROR(PB.parsePassPipeline(MPM, "parallel-function<0>(dce)"),
+                    Failed());
+  EXPECT_THAT_ERROR(PB.parsePassPipeline(MPM, "parallel-function<2>(inline)"),
+                    Failed());
+}
+
+} // end anonymous namespace
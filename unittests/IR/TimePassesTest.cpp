@@ -166,4 +166,45 @@ TEST(TimePassesTest, CustomOut) {
   EXPECT_TRUE(TimePassesStr.str().contains("Pass2"));
 }
 
+TEST(TimePassesTest, PerfCounters) {
+  // Hardware counters are not available everywhere, e.g. in most virtual
+  // machines, in which case the report only has the timers.
+  bool HaveCounters = PerfEventCounters().isValid();
+
+  PassInstrumentationCallbacks PIC;
+  PassInstrumentation PI(&PIC);
+
+  LLVMContext Context;
+  Module M("TestModule", Context);
+  Function *F = Function::Create(
+      FunctionType::get(Type::getVoidTy(Context), false),
+      GlobalValue::ExternalLinkage, "counted_function", M);
+  MyPass1 Pass1;
+  MyPass2 Pass2;
+
+  SmallString<0> TimePassesStr;
+  raw_svector_ostream ReportStream(TimePassesStr);
+
+  TimePassesHandler TimePasses(true, /*PerfCounters=*/true);
+  TimePasses.setOutStream(ReportStream);
+  TimePasses.registerCallbacks(PIC);
+
+  PI.runBeforePass(Pass1, M);
+  PI.runAfterPass(Pass1, M);
+  PI.runBeforePass(Pass2, *F);
+  PI.runAfterPass(Pass2, *F);
+
+  TimePasses.print();
+  EXPECT_TRUE(TimePassesStr.str().contains("Pass1"));
+  EXPECT_TRUE(TimePassesStr.str().contains("Pass2"));
+  EXPECT_EQ(HaveCounters,
+            TimePassesStr.str().contains("hardware event counts"));
+  EXPECT_EQ(HaveCounters, TimePassesStr.str().contains("counted_function"));
+
+  // The counts are reset along with the timers.
+  TimePassesStr.clear();
+  TimePasses.print();
+  EXPECT_TRUE(TimePassesStr.empty());
+}
+
 } // end anonymous namespace
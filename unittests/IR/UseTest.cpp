@@ -7,7 +7,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/User.h"
@@ -107,4 +109,37 @@ TEST(UseTest, reverse) {
   ASSERT_EQ(8u, I);
 }
 
+TEST(UseTest, getUser) {
+  LLVMContext C;
+  Type *Int32Ty = Type::getInt32Ty(C);
+
+  // Co-allocated operands, enough of them for getUser() to walk a long way
+  // with LLVM_ENABLE_COMPACT_USES.
+  std::vector<Constant *> Elts;
+  for (unsigned I = 0; I != 1000; ++I)
+    Elts.push_back(ConstantInt::get(Int32Ty, I));
+  Constant *CA = ConstantArray::get(ArrayType::get(Int32Ty, Elts.size()), Elts);
+  for (Use &U : CA->operands()) {
+    EXPECT_EQ(CA, U.getUser());
+    EXPECT_EQ(U.getOperandNo(), cast<ConstantInt>(U)->getZExtValue());
+  }
+
+  // Hung off operands, which are reallocated as they grow.
+  Module M("M", C);
+  Function *F =
+      Function::Create(FunctionType::get(Int32Ty, false),
+                       GlobalValue::ExternalLinkage, "f", M);
+  std::vector<BasicBlock *> Blocks;
+  for (unsigned I = 0; I != 100; ++I)
+    Blocks.push_back(BasicBlock::Create(C, "", F));
+  PHINode *PN = PHINode::Create(Int32Ty, 1, "", Blocks[0]);
+  for (unsigned I = 0; I != Blocks.size(); ++I)
+    PN->addIncoming(Elts[I], Blocks[I]);
+  for (Use &U : PN->incoming_values()) {
+    EXPECT_EQ(PN, U.getUser());
+    EXPECT_EQ(Blocks[U.getOperandNo()], PN->getIncomingBlock(U));
+    EXPECT_EQ(Elts[U.getOperandNo()], U.get());
+  }
+}
+
 } // end anonymous namespace
@@ -0,0 +1,174 @@
+//===- llvm/unittest/LTO/LTOBackendTest.cpp -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/LTOBackend.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/LTO/Config.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+const char *DataLayout = "target datalayout = \"e-m:e-i64:64-n8:16:32:64\"\n"
+                         "target triple = \"x86_64-unknown-linux-gnu\"\n";
+
+/// Source module whose @callee is imported. The body of @other is never
+/// imported.
+std::string createSource(StringRef CalleeBody, StringRef OtherBody,
+                         bool CalleeCallsLocal = false) {
+  std::string Assembly = DataLayout;
+  Assembly += "define internal i32 @helper(i32 %x) {\n"
+              "  ret i32 %x\n"
+              "}\n"
+              "define i32 @callee(i32 %x) {\n";
+  Assembly += CalleeBody;
+  if (CalleeCallsLocal)
+    Assembly += "  %h = call i32 @helper(i32 %r)\n"
+                "  ret i32 %h\n";
+  else
+    Assembly += "  ret i32 %r\n";
+  Assembly += "}\n"
+              "define i32 @other(i32 %x) {\n";
+  Assembly += OtherBody;
+  Assembly += "  %u = call i32 @helper(i32 %o)\n"
+              "  ret i32 %u\n"
+              "}\n";
+  return Assembly;
+}
+
+std::string createImporter(StringRef Body) {
+  std::string Assembly = DataLayout;
+  Assembly += "declare i32 @callee(i32)\n"
+              "define i32 @main(i32 %x) {\n";
+  Assembly += Body;
+  Assembly += "  %c = call i32 @callee(i32 %y)\n"
+              "  ret i32 %c\n"
+              "}\n";
+  return Assembly;
+}
+
+/// Writes \p Assembly to bitcode with a module summary and a module hash, as
+/// for a ThinLTO link.
+std::string writeWithSummary(const std::string &Assembly) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(Assembly, Err, Context);
+  if (!M)
+    report_fatal_error(Err.getMessage());
+  ProfileSummaryInfo PSI(*M);
+  ModuleSummaryIndex Index =
+      buildModuleSummaryIndex(*M, /*GetBFICallback=*/nullptr, &PSI);
+  std::string Bitcode;
+  raw_string_ostream OS(Bitcode);
+  WriteBitcodeToFile(*M, OS, /*ShouldPreserveUseListOrder=*/false, &Index,
+                     /*GenerateHash=*/true);
+  return OS.str();
+}
+
+/// Returns the hash of what the module \p ImporterName with the contents
+/// \p Importer imports from \p Source, which is always named "source", when
+/// it imports @callee.
+ModuleHash hashImports(StringRef ImporterName, const std::string &Importer,
+                       const std::string &Source) {
+  std::string ImporterBitcode = writeWithSummary(Importer);
+  std::string SourceBitcode = writeWithSummary(Source);
+  MemoryBufferRef ImporterRef(ImporterBitcode, ImporterName);
+  MemoryBufferRef SourceRef(SourceBitcode, "source");
+
+  ModuleSummaryIndex CombinedIndex(/*HaveGVs=*/false);
+  EXPECT_FALSE(errorToBool(readModuleSummaryIndex(ImporterRef, CombinedIndex,
+                                                  /*ModuleId=*/0)));
+  EXPECT_FALSE(errorToBool(readModuleSummaryIndex(SourceRef, CombinedIndex,
+                                                  /*ModuleId=*/1)));
+
+  Expected<std::vector<BitcodeModule>> ImporterModules =
+      getBitcodeModuleList(ImporterRef);
+  Expected<std::vector<BitcodeModule>> SourceModules =
+      getBitcodeModuleList(SourceRef);
+  if (!ImporterModules || !SourceModules) {
+    ADD_FAILURE() << "Could not read bitcode";
+    consumeError(ImporterModules.takeError());
+    consumeError(SourceModules.takeError());
+    return {};
+  }
+  MapVector<StringRef, BitcodeModule> ModuleMap;
+  ModuleMap.insert({"source", (*SourceModules)[0]});
+
+  FunctionImporter::ImportMapTy ImportList;
+  ImportList["source"].insert(GlobalValue::getGUID("callee"));
+
+  lto::Config Conf;
+  Expected<ModuleHash> Hash = lto::computeImportsHash(
+      Conf, (*ImporterModules)[0], CombinedIndex, ImportList, ModuleMap);
+  if (!Hash) {
+    ADD_FAILURE() << toString(Hash.takeError());
+    return {};
+  }
+  return *Hash;
+}
+
+TEST(LTOBackendTest, ImportsHashChangesWithImportedBody) {
+  std::string Importer = createImporter("  %y = add i32 %x, 1\n");
+  ModuleHash Hash = hashImports(
+      "importer", Importer,
+      createSource("  %r = add i32 %x, 1\n", "  %o = mul i32 %x, 3\n"));
+  EXPECT_NE(Hash, hashImports("importer", Importer,
+                              createSource("  %r = add i32 %x, 2\n",
+                                           "  %o = mul i32 %x, 3\n")));
+}
+
+TEST(LTOBackendTest, ImportsHashIgnoresUnrelatedContent) {
+  // Changing @other changes the module hash of the source module, but not
+  // what is imported from it.
+  std::string Importer = createImporter("  %y = add i32 %x, 1\n");
+  ModuleHash Hash = hashImports(
+      "importer", Importer,
+      createSource("  %r = add i32 %x, 1\n", "  %o = mul i32 %x, 3\n"));
+  EXPECT_EQ(Hash, hashImports("importer", Importer,
+                              createSource("  %r = add i32 %x, 1\n",
+                                           "  %o = mul i32 %x, 5\n")));
+}
+
+TEST(LTOBackendTest, ImportsHashIgnoresImportingModule) {
+  for (bool CalleeCallsLocal : {false, true}) {
+    std::string Source = createSource("  %r = add i32 %x, 1\n",
+                                      "  %o = mul i32 %x, 3\n",
+                                      CalleeCallsLocal);
+    EXPECT_EQ(hashImports("a", createImporter("  %y = add i32 %x, 1\n"),
+                          Source),
+              hashImports("b", createImporter("  %y = sub i32 %x, 7\n"),
+                          Source))
+        << "CalleeCallsLocal=" << CalleeCallsLocal;
+  }
+}
+
+TEST(LTOBackendTest, ImportsHashFollowsPromotedNames) {
+  // The promoted name of @helper, which the imported @callee refers to,
+  // embeds the module hash of the source module, so the object built with the
+  // imports changes whenever the source module does.
+  std::string Importer = createImporter("  %y = add i32 %x, 1\n");
+  ModuleHash Hash = hashImports(
+      "importer", Importer,
+      createSource("  %r = add i32 %x, 1\n", "  %o = mul i32 %x, 3\n",
+                   /*CalleeCallsLocal=*/true));
+  EXPECT_NE(Hash, hashImports("importer", Importer,
+                              createSource("  %r = add i32 %x, 1\n",
+                                           "  %o = mul i32 %x, 5\n",
+                                           /*CalleeCallsLocal=*/true)));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,294 @@
+//===- llvm/unittests/MC/X86/MCAssemblerRelaxationTest.cpp ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCCodeEmitter.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCParser/MCAsmParser.h"
+#include "llvm/MC/MCParser/MCTargetAsmParser.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/MCTargetOptions.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+const char *TripleName = "x86_64-unknown-linux-gnu";
+
+/// Assembles sources into ELF objects and checks the encodings the layout
+/// settled on. Each case needs fragments to be relaxed again after another
+/// fragment changed size, in the same section or in a section laid out before
+/// it.
+class MCAssemblerRelaxationTest : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    LLVMInitializeX86TargetInfo();
+    LLVMInitializeX86TargetMC();
+    LLVMInitializeX86AsmParser();
+  }
+
+  void SetUp() override {
+    std::string Error;
+    T = TargetRegistry::lookupTarget(TripleName, Error);
+    AlignBranchBoundary = static_cast<cl::opt<unsigned> *>(
+        cl::getRegisteredOptions().lookup("x86-align-branch-boundary"));
+  }
+
+  void TearDown() override {
+    if (AlignBranchBoundary)
+      *AlignBranchBoundary = 0;
+  }
+
+  /// Assembles \p Source and returns the contents of the sections of the
+  /// object by name.
+  StringMap<std::string> assemble(StringRef Source) {
+    SourceMgr SrcMgr;
+    SrcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Source), SMLoc());
+    MCTargetOptions MCOptions;
+    std::unique_ptr<MCRegisterInfo> MRI(T->createMCRegInfo(TripleName));
+    std::unique_ptr<MCAsmInfo> MAI(
+        T->createMCAsmInfo(*MRI, TripleName, MCOptions));
+    std::unique_ptr<MCInstrInfo> MII(T->createMCInstrInfo());
+    std::unique_ptr<MCSubtargetInfo> STI(
+        T->createMCSubtargetInfo(TripleName, "", ""));
+    MCObjectFileInfo MOFI;
+    MCContext Ctx(MAI.get(), MRI.get(), &MOFI, &SrcMgr, &MCOptions);
+    MOFI.InitMCObjectFileInfo(Triple(TripleName), /*PIC=*/false, Ctx);
+
+    SmallString<0> Object;
+    {
+      raw_svector_ostream OS(Object);
+      MCAsmBackend *MAB = T->createMCAsmBackend(*STI, *MRI, MCOptions);
+      std::unique_ptr<MCStreamer> Str(T->createMCObjectStreamer(
+          Triple(TripleName), Ctx, std::unique_ptr<MCAsmBackend>(MAB),
+          MAB->createObjectWriter(OS),
+          std::unique_ptr<MCCodeEmitter>(
+              T->createMCCodeEmitter(*MII, *MRI, Ctx)),
+          *STI, MCOptions.MCRelaxAll, MCOptions.MCIncrementalLinkerCompatible,
+          /*DWARFMustBeAtTheEnd=*/false));
+      Str->setUseAssemblerInfoForParsing(true);
+      std::unique_ptr<MCAsmParser> Parser(
+          createMCAsmParser(SrcMgr, Ctx, *Str, *MAI));
+      std::unique_ptr<MCTargetAsmParser> TAP(
+          T->createMCAsmParser(*STI, *Parser, *MII, MCOptions));
+      Parser->setTargetParser(*TAP);
+      if (Parser->Run(/*NoInitialDirectives=*/false))
+        return {};
+    }
+
+    StringMap<std::string> Sections;
+    Expected<std::unique_ptr<object::ObjectFile>> Obj =
+        object::ObjectFile::createObjectFile(MemoryBufferRef(Object, ""));
+    if (!Obj) {
+      consumeError(Obj.takeError());
+      return {};
+    }
+    for (const object::SectionRef &Sec : (*Obj)->sections()) {
+      Expected<StringRef> Name = Sec.getName();
+      Expected<StringRef> Contents = Sec.getContents();
+      if (Name && Contents)
+        Sections[*Name] = Contents->str();
+      else {
+        consumeError(Name.takeError());
+        consumeError(Contents.takeError());
+      }
+    }
+    return Sections;
+  }
+
+  static int64_t readRel32(StringRef Data, size_t Offset) {
+    return int32_t(support::endian::read32le(Data.data() + Offset));
+  }
+
+  const Target *T = nullptr;
+  cl::opt<unsigned> *AlignBranchBoundary = nullptr;
+};
+
+TEST_F(MCAssemblerRelaxationTest, BranchChain) {
+  if (!T)
+    return;
+
+  // Every branch jumps over the next one to a target that is in range of its
+  // short form only as long as the next branch is short. The last branch is
+  // out of range, so relaxing it pushes out the one before, and so on up the
+  // chain.
+  const unsigned NumBranches = 50;
+  std::string Source = ".text\n";
+  for (unsigned I = 0; I != NumBranches; ++I) {
+    Source += "jmp .Lt" + std::to_string(I) + "\n";
+    if (I)
+      Source += ".Lt" + std::to_string(I - 1) + ":\n";
+    Source += I + 1 == NumBranches ? ".space 200\n" : ".space 124\n";
+  }
+  Source += ".Lt" + std::to_string(NumBranches - 1) + ":\n";
+
+  StringMap<std::string> Sections = assemble(Source);
+  ASSERT_TRUE(Sections.count(".text"));
+  StringRef Text = Sections[".text"];
+  ASSERT_EQ(Text.size(), (NumBranches - 1) * (5 + 124) + 5 + 200);
+  for (unsigned I = 0; I != NumBranches; ++I) {
+    size_t Offset = I * (5 + 124);
+    EXPECT_EQ(uint8_t(Text[Offset]), 0xe9) << "branch " << I;
+    EXPECT_EQ(readRel32(Text, Offset + 1), I + 1 == NumBranches ? 200 : 129)
+        << "branch " << I;
+  }
+}
+
+TEST_F(MCAssemblerRelaxationTest, LEBInEarlierSection) {
+  if (!T)
+    return;
+
+  // The distance the LEB encodes grows past 127 when the branch between its
+  // symbols is relaxed, which is only known after the section that holds the
+  // LEB was laid out.
+  StringMap<std::string> Sections = assemble(R"(
+    .section .lebs,"a",@progbits
+    .uleb128 .Le - .Ls
+    .byte 0xcc
+    .section .code,"ax",@progbits
+  .Ls:
+    jmp .Lfar
+    .space 123
+  .Le:
+    .space 10
+  .Lfar:
+  )");
+  ASSERT_TRUE(Sections.count(".lebs") && Sections.count(".code"));
+  EXPECT_EQ(Sections[".lebs"], "\x80\x01\xcc");
+  StringRef Code = Sections[".code"];
+  ASSERT_EQ(Code.size(), 5u + 123 + 10);
+  EXPECT_EQ(uint8_t(Code[0]), 0xe9);
+  EXPECT_EQ(readRel32(Code, 1), 133);
+}
+
+TEST_F(MCAssemblerRelaxationTest, FillInEarlierSection) {
+  if (!T)
+    return;
+
+  // The fill grows when the branch between its symbols is relaxed, which takes
+  // the branch back across it out of range. Nothing in the section of the
+  // fill changed size when it grew, so the fill has to be measured again
+  // rather than read off the layout of its section, which the branch made
+  // with the old size.
+  StringMap<std::string> Sections = assemble(R"(
+    .section .fills,"ax",@progbits
+  .Lf:
+    .fill .Le - .Ls, 1, 0xcc
+    jmp .Lf
+    .section .code,"ax",@progbits
+  .Ls:
+    jmp .Lfar
+    .space 123
+  .Le:
+    .space 10
+  .Lfar:
+  )");
+  ASSERT_TRUE(Sections.count(".fills") && Sections.count(".code"));
+  StringRef Fills = Sections[".fills"];
+  ASSERT_EQ(Fills.size(), 128u + 5);
+  EXPECT_EQ(Fills.take_front(128), std::string(128, '\xcc'));
+  EXPECT_EQ(uint8_t(Fills[128]), 0xe9);
+  EXPECT_EQ(readRel32(Fills, 129), -133);
+  StringRef Code = Sections[".code"];
+  ASSERT_EQ(Code.size(), 5u + 123 + 10);
+  EXPECT_EQ(uint8_t(Code[0]), 0xe9);
+  EXPECT_EQ(readRel32(Code, 1), 133);
+}
+
+TEST_F(MCAssemblerRelaxationTest, Org) {
+  if (!T)
+    return;
+
+  // The padding of the org shrinks when the branch before it is relaxed, and
+  // so does the distance the LEB encodes across it.
+  StringMap<std::string> Sections = assemble(R"(
+    .section .orgs,"ax",@progbits
+    jmp .Lo1
+    .space 130
+  .Lo1:
+    jmp .Lo3
+  .Lo2:
+    .org 0x100, 0x90
+  .Lo3:
+    ret
+    .section .orglebs,"a",@progbits
+    .uleb128 .Lo3 - .Lo2
+  )");
+  ASSERT_TRUE(Sections.count(".orgs") && Sections.count(".orglebs"));
+  StringRef Code = Sections[".orgs"];
+  ASSERT_EQ(Code.size(), 0x101u);
+  EXPECT_EQ(uint8_t(Code[0]), 0xe9);
+  EXPECT_EQ(readRel32(Code, 1), 130);
+  // The branch across the org stays short.
+  EXPECT_EQ(uint8_t(Code[135]), 0xeb);
+  EXPECT_EQ(uint8_t(Code[136]), 0x100 - 137);
+  EXPECT_EQ(uint8_t(Code[137]), 0x90);
+  EXPECT_EQ(uint8_t(Code[0x100]), 0xc3);
+  EXPECT_EQ(Sections[".orglebs"], std::string(1, char(0x100 - 137)));
+}
+
+TEST_F(MCAssemblerRelaxationTest, BoundaryAlign) {
+  if (!T)
+    return;
+  ASSERT_TRUE(AlignBranchBoundary);
+  // The backend only reads the options if they occurred on the command line.
+  // A boundary of 0 disables the alignment, which TearDown restores.
+  static bool AlignJumps = [] {
+    StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+    return !Options["x86-align-branch"]->addOccurrence(0, "x86-align-branch",
+                                                        "jmp") &&
+           !Options["x86-align-branch-boundary"]->addOccurrence(
+               0, "x86-align-branch-boundary", "0");
+  }();
+  ASSERT_TRUE(AlignJumps);
+  *AlignBranchBoundary = 32;
+
+  // Relaxing the first branch moves the second jmp to end at a 32-byte
+  // boundary, so it gets padded. The padding takes the jne across it out of
+  // range. Relaxing the jne moves the jmp past the boundary, and the padding
+  // is removed again.
+  StringMap<std::string> Sections = assemble(R"(
+    .section .balign,"ax",@progbits
+    jmp .Lb1
+    .space 130
+  .Lb1:
+    jne .Lc
+    .space 21
+    jmp .Lb2
+  .Lb2:
+    .space 103
+  .Lc:
+  )");
+  ASSERT_TRUE(Sections.count(".balign"));
+  StringRef Code = Sections[".balign"];
+  ASSERT_EQ(Code.size(), 267u);
+  EXPECT_EQ(uint8_t(Code[0]), 0xe9);
+  EXPECT_EQ(readRel32(Code, 1), 130);
+  EXPECT_EQ(uint8_t(Code[135]), 0x0f);
+  EXPECT_EQ(uint8_t(Code[136]), 0x85);
+  EXPECT_EQ(readRel32(Code, 137), 126);
+  EXPECT_EQ(uint8_t(Code[162]), 0xeb);
+  EXPECT_EQ(uint8_t(Code[163]), 0x00);
+}
+
+} // end anonymous namespace
@@ -6,6 +6,7 @@
 #include "llvm/CodeGen/TargetRegisterInfo.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
@@ -608,6 +609,44 @@ TEST(LiveIntervalTest, BundleSubRegDef) {
   });
 }
 
+TEST(LiveIntervalTest, ParallelComputeVirtRegs) {
+  // The intervals computed on multiple threads, including the dead defs and
+  // the split of %5, must match the ones computed serially.
+  StringRef MIRFunc = R"MIR(
+    successors: %bb.1, %bb.2
+    undef %0.sub0 = IMPLICIT_DEF
+    %1:sreg_32 = IMPLICIT_DEF
+    %2:sreg_32 = IMPLICIT_DEF
+    %5:sreg_32 = IMPLICIT_DEF
+    %5:sreg_32 = IMPLICIT_DEF
+    S_CBRANCH_VCCNZ %bb.2, implicit undef $vcc
+    S_BRANCH %bb.1
+  bb.1:
+    %0.sub1 = IMPLICIT_DEF
+    %3:sreg_32 = IMPLICIT_DEF
+    S_NOP 0, implicit %1, implicit %3
+  bb.2:
+    %4:sreg_32 = IMPLICIT_DEF
+    S_NOP 0, implicit %0.sub0, implicit %2
+)MIR";
+  auto *Threshold = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions().lookup("parallel-liveintervals-threshold"));
+  ASSERT_TRUE(Threshold);
+
+  std::string Serial, Parallel;
+  auto Print = [](std::string &Out) {
+    return [&Out](MachineFunction &MF, LiveIntervals &LIS) {
+      raw_string_ostream OS(Out);
+      LIS.print(OS, nullptr);
+    };
+  };
+  liveIntervalTest(MIRFunc, Print(Serial));
+  Threshold->setValue(1);
+  liveIntervalTest(MIRFunc, Print(Parallel));
+  Threshold->setValue(0);
+  EXPECT_EQ(Serial, Parallel);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   initLLVM();
@@ -221,6 +221,50 @@ TEST_F(InstrProfTest, test_writer_merge) {
   ASSERT_EQ(0U, R->Counts[1]);
 }
 
+// Tests that sharding records by function name and merging the shards, as
+// llvm-profdata merge does with several threads, writes the same profile as
+// adding every record to one writer.
+TEST_F(InstrProfTest, test_writer_sharded_merge) {
+  // Inputs that each have a different subset of the functions, some with
+  // more than one hash.
+  const unsigned NumInputs = 8, NumFunctions = 2000;
+  std::vector<std::vector<NamedInstrProfRecord>> Inputs(NumInputs);
+  std::vector<std::string> Names;
+  for (unsigned F = 0; F != NumFunctions; ++F)
+    Names.push_back("func" + std::to_string(F));
+  for (unsigned I = 0; I != NumInputs; ++I)
+    for (unsigned F = I; F < NumFunctions; F += I + 1)
+      Inputs[I].push_back(
+          {Names[F], 0x1000 + 4 * ((F + I) % 3), {I + 1, F, uint64_t(I) * F}});
+
+  InstrProfWriter Serial;
+  for (unsigned I = 0; I != NumInputs; ++I)
+    for (NamedInstrProfRecord R : Inputs[I])
+      Serial.addRecord(std::move(R), /*Weight=*/I % 2 + 1, Err);
+  std::string Expected = Serial.writeBuffer()->getBuffer().str();
+
+  for (unsigned NumShards : {2u, 3u, 4u}) {
+    std::vector<InstrProfWriter> Shards(NumShards);
+    // Load the inputs in a different order than the serial merge.
+    for (unsigned I = NumInputs; I-- != 0;)
+      for (NamedInstrProfRecord R : Inputs[I])
+        Shards[hash_value(R.Name) % NumShards].addRecord(
+            std::move(R), /*Weight=*/I % 2 + 1, Err);
+    unsigned Mid = NumShards / 2, End = NumShards;
+    do {
+      for (unsigned I = 0; I < Mid; ++I)
+        Shards[I].mergeRecordsFromWriter(std::move(Shards[I + Mid]), Err);
+      if (End & 1)
+        Shards[0].mergeRecordsFromWriter(std::move(Shards[End - 1]), Err);
+      End = Mid;
+      Mid /= 2;
+    } while (Mid > 0);
+
+    EXPECT_TRUE(Expected == Shards[0].writeBuffer()->getBuffer())
+        << "NumShards=" << NumShards;
+  }
+}
+
 static const char callee1[] = "callee1";
 static const char callee2[] = "callee2";
 static const char callee3[] = "callee3";
@@ -12,9 +12,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Parallel.h"
+#include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
 #include <random>
+#include <thread>
 
 uint32_t array[1024 * 1024];
 
@@ -49,4 +52,67 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, NestedForEach) {
+  // Nested parallel loops must not deadlock even though the outer tasks
+  // occupy every worker while waiting for their inner TaskGroups.
+  std::atomic<unsigned> Count(0);
+  parallelForEachN(0, 64, [&](size_t) {
+    parallelForEachN(0, 2048, [&](size_t) { ++Count; });
+  });
+  ASSERT_EQ(Count, 64u * 2048u);
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(Parallel, TaskGroupPriority) {
+  std::atomic<unsigned> Count(0);
+  {
+    parallel::detail::TaskGroup TG;
+    for (unsigned I = 0; I < 100; ++I)
+      TG.spawn([&] { ++Count; }, I % 2 ? parallel::TaskPriority::High
+                                        : parallel::TaskPriority::Normal);
+  }
+  ASSERT_EQ(Count, 100u);
+}
+
+TEST(Parallel, NestedSyncWaitsForSibling) {
+  // The worker syncing the inner group has nothing to run while the last task
+  // of the group runs on another worker, so it has to sleep until that task
+  // finishes instead of spinning.
+  if (parallel::strategy.compute_thread_count() < 2)
+    return;
+  std::atomic<bool> Started(false), Release(false), Synced(false);
+  std::chrono::milliseconds CPUTime;
+  {
+    parallel::detail::TaskGroup Outer;
+    Outer.spawn([&] {
+      parallel::detail::TaskGroup Inner;
+      Inner.spawn([&] {
+        Started = true;
+        while (!Release)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      });
+      // Leave the sibling to another worker.
+      while (!Started)
+        std::this_thread::yield();
+      Inner.sync();
+      Synced = true;
+    });
+    while (!Started)
+      std::this_thread::yield();
+
+    sys::TimePoint<> Now;
+    std::chrono::nanoseconds UserBefore, SysBefore, UserAfter, SysAfter;
+    sys::Process::GetTimeUsage(Now, UserBefore, SysBefore);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    sys::Process::GetTimeUsage(Now, UserAfter, SysAfter);
+    CPUTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        (UserAfter - UserBefore) + (SysAfter - SysBefore));
+    EXPECT_FALSE(Synced);
+    Release = true;
+  }
+  EXPECT_TRUE(Synced);
+  EXPECT_LT(CPUTime.count(), 50);
+}
+#endif
+
 #endif
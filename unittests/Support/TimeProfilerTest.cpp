@@ -0,0 +1,85 @@
+//===- llvm/unittest/Support/TimeProfilerTest.cpp - Time profiler tests ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/JSON.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// Returns the names of the events of the trace, in order, and the count of
+// the "Total <Name>" event.
+std::vector<std::string> writeTrace(StringRef Name, int64_t &TotalCount) {
+  SmallString<1024> Trace;
+  raw_svector_ostream OS(Trace);
+  timeTraceProfilerWrite(OS);
+  timeTraceProfilerCleanup();
+
+  std::vector<std::string> Names;
+  TotalCount = 0;
+  Expected<json::Value> Parsed = json::parse(Trace);
+  EXPECT_TRUE(!!Parsed);
+  if (!Parsed)
+    return Names;
+  for (const json::Value &Event :
+       *Parsed->getAsObject()->getArray("traceEvents")) {
+    const json::Object *Obj = Event.getAsObject();
+    if (*Obj->getString("ph") != "X")
+      continue;
+    StringRef EventName = *Obj->getString("name");
+    if (EventName == ("Total " + Name).str())
+      TotalCount = *Obj->getObject("args")->getInteger("count");
+    else if (!EventName.startswith("Total "))
+      Names.push_back(EventName.str());
+  }
+  return Names;
+}
+
+TEST(TimeProfiler, Scopes) {
+  timeTraceProfilerInitialize(/*TimeTraceGranularity=*/0, "test");
+  {
+    TimeTraceScope Outer("outer", StringRef("detail"));
+    TimeTraceScope Inner("inner");
+  }
+  int64_t Count;
+  EXPECT_EQ(writeTrace("outer", Count),
+            (std::vector<std::string>{"inner", "outer"}));
+  EXPECT_EQ(Count, 1);
+}
+
+TEST(TimeProfiler, MaxEntries) {
+  timeTraceProfilerInitialize(/*TimeTraceGranularity=*/0, "test",
+                              /*MaxEntries=*/2);
+  for (int I = 0; I != 5; ++I)
+    TimeTraceScope Scope("scope" + std::to_string(I));
+  {
+    TimeTraceScope Scope("scope5", StringRef("detail"));
+  }
+  int64_t Count;
+  EXPECT_EQ(writeTrace("scope5", Count),
+            (std::vector<std::string>{"scope4", "scope5"}));
+  EXPECT_EQ(Count, 1);
+}
+
+TEST(TimeProfiler, SampleInterval) {
+  timeTraceProfilerInitialize(/*TimeTraceGranularity=*/0, "test",
+                              /*MaxEntries=*/0, /*SampleInterval=*/2);
+  for (int I = 0; I != 4; ++I) {
+    TimeTraceScope Outer("outer" + std::to_string(I));
+    TimeTraceScope Inner("inner");
+  }
+  int64_t Count;
+  EXPECT_EQ(writeTrace("inner", Count),
+            (std::vector<std::string>{"inner", "outer0", "inner", "outer2"}));
+  EXPECT_EQ(Count, 2);
+}
+
+} // namespace